@@ -0,0 +1,102 @@
+#include "alloc_stats.hpp"
+
+#ifdef LOX_ALLOC_STATS
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+  std::atomic<std::uint64_t> allocations{0};
+  std::atomic<std::uint64_t> bytes{0};
+
+  void* counted_allocate(std::size_t size, std::size_t align)
+  {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    if (size == 0)
+    {
+      size = 1;
+    }
+    void *memory = align <= alignof(std::max_align_t)
+      ? std::malloc(size)
+      : std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (memory == nullptr)
+    {
+      throw std::bad_alloc();
+    }
+    return memory;
+  }
+}
+
+void* operator new(std::size_t size)
+{
+  return counted_allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size)
+{
+  return counted_allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+  return counted_allocate(size, static_cast<std::size_t>(align));
+}
+
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+  return counted_allocate(size, static_cast<std::size_t>(align));
+}
+
+void operator delete(void *memory) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept
+{
+  std::free(memory);
+}
+
+alloc_stats::Snapshot alloc_stats::snapshot()
+{
+  return {allocations.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed)};
+}
+#else
+alloc_stats::Snapshot alloc_stats::snapshot()
+{
+  return {};
+}
+#endif
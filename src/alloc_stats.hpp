@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Process wide heap allocation counters. They are only maintained when the
+ * build defines LOX_ALLOC_STATS, which replaces the global operator new and
+ * delete; otherwise counting() is false and every snapshot is zero.
+ */
+namespace alloc_stats
+{
+  struct Snapshot
+  {
+    std::uint64_t allocations{0};
+    std::uint64_t bytes{0};
+  };
+
+  constexpr bool counting()
+  {
+#ifdef LOX_ALLOC_STATS
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // allocations and bytes requested since the process started
+  Snapshot snapshot();
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Bump allocator handing out memory from large blocks. Objects are never
+ * destroyed individually, everything allocated is dropped at once by
+ * release() or when the arena goes away, so only trivially destructible
+ * types may live in it.
+ */
+class Arena
+{
+public:
+  static constexpr std::size_t default_block_size = 64 * 1024;
+
+  explicit Arena(std::size_t block_size = default_block_size)
+    : m_block_size(block_size)
+  {
+  }
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  Arena(Arena &&) noexcept = default;
+  Arena &operator=(Arena &&) noexcept = default;
+
+  template<typename T, typename... Args>
+  T* make(Args&&... args)
+  {
+    static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+    void *memory = allocate(sizeof(T), alignof(T));
+    return ::new (memory) T(std::forward<Args>(args)...);
+  }
+
+  void* allocate(std::size_t size, std::size_t align)
+  {
+    std::size_t offset = (m_offset + align - 1) & ~(align - 1);
+    if (m_blocks.empty() || offset + size > m_blocks.back().size)
+    {
+      grow(size + align);
+      offset = (m_offset + align - 1) & ~(align - 1);
+    }
+    m_offset = offset + size;
+    m_bytes_used += size;
+    ++m_allocation_count;
+    return m_blocks.back().data.get() + offset;
+  }
+
+  // Drop everything allocated so far. The first block is kept for reuse.
+  void release()
+  {
+    if (m_blocks.size() > 1)
+    {
+      m_blocks.resize(1);
+    }
+    m_offset = 0;
+    m_bytes_used = 0;
+    m_allocation_count = 0;
+  }
+
+  // number of objects allocated since the last release
+  [[nodiscard]] std::size_t allocation_count() const
+  {
+    return m_allocation_count;
+  }
+
+  // bytes handed out since the last release, excluding alignment padding
+  [[nodiscard]] std::size_t bytes_used() const
+  {
+    return m_bytes_used;
+  }
+
+  // bytes currently held in blocks
+  [[nodiscard]] std::size_t bytes_reserved() const
+  {
+    std::size_t reserved = 0;
+    for (const auto &block : m_blocks)
+    {
+      reserved += block.size;
+    }
+    return reserved;
+  }
+
+private:
+  struct Block
+  {
+    std::unique_ptr<std::byte[]> data;
+    std::size_t size;
+  };
+
+  void grow(std::size_t min_size)
+  {
+    std::size_t size = std::max(m_block_size, min_size);
+    m_blocks.push_back(Block{std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+    m_offset = 0;
+  }
+
+  std::vector<Block> m_blocks;
+  std::size_t m_block_size;
+  std::size_t m_offset{0}; // bump pointer into the last block
+  std::size_t m_bytes_used{0};
+  std::size_t m_allocation_count{0};
+};
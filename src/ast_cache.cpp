@@ -0,0 +1,331 @@
+#include "ast_cache.hpp"
+
+#include "source.hpp"
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <span>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+  constexpr char magic[8] = {'J', 'L', 'O', 'X', 'A', 'S', 'T', '\n'};
+  constexpr std::string_view extension = ".ast";
+
+  struct Header
+  {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint32_t node_size;
+    std::uint32_t token_size;
+    std::uint64_t source_hash;
+    std::uint64_t source_size;
+    std::uint32_t node_count;
+    std::uint32_t token_count;
+    std::uint32_t value_count;
+    std::uint32_t root_count;
+    std::uint32_t string_count;
+    std::uint32_t string_bytes;
+  };
+
+  // a Value with its string replaced by an index into the string section
+  struct StoredValue
+  {
+    Value::Type type;
+    bool boolean;
+    std::uint32_t string;
+    double number;
+  };
+
+  static_assert(std::is_trivially_copyable_v<Header>);
+  static_assert(std::is_trivially_copyable_v<FlatExprNode>);
+  static_assert(std::is_trivially_copyable_v<Token>);
+  static_assert(std::is_trivially_copyable_v<StoredValue>);
+
+  constexpr std::size_t align_up(std::size_t offset)
+  {
+    return (offset + 7) & ~std::size_t{7};
+  }
+
+  // the sections in file order, every one starts 8 byte aligned
+  struct Layout
+  {
+    std::size_t nodes;
+    std::size_t tokens;
+    std::size_t values;
+    std::size_t roots;
+    std::size_t string_offsets;
+    std::size_t string_bytes;
+    std::size_t source;
+    std::size_t end;
+
+    explicit Layout(const Header &header)
+    {
+      nodes = align_up(sizeof(Header));
+      tokens = align_up(nodes + std::size_t{header.node_count} * sizeof(FlatExprNode));
+      values = align_up(tokens + std::size_t{header.token_count} * sizeof(Token));
+      roots = align_up(values + std::size_t{header.value_count} * sizeof(StoredValue));
+      string_offsets = align_up(roots + std::size_t{header.root_count} * sizeof(ExprIndex));
+      string_bytes = align_up(string_offsets + (std::size_t{header.string_count} + 1) * sizeof(std::uint32_t));
+      source = align_up(string_bytes + header.string_bytes);
+      end = source + header.source_size;
+    }
+  };
+
+  // count records of type T stored at offset, the section is 8 byte aligned
+  // in a page aligned mapping
+  template<typename T>
+  std::span<const T> borrow(std::string_view file, std::size_t offset, std::size_t count)
+  {
+    static_assert(alignof(T) <= 8);
+    return {reinterpret_cast<const T *>(file.data() + offset), count};
+  }
+
+  std::uint64_t read_u64(const char *data)
+  {
+    std::uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+  }
+}
+
+std::filesystem::path AstCache::default_directory()
+{
+  if (const char *directory = std::getenv("LOX_CACHE_DIR"); directory != nullptr && *directory != '\0')
+  {
+    return directory;
+  }
+  if (const char *cache = std::getenv("XDG_CACHE_HOME"); cache != nullptr && *cache != '\0')
+  {
+    return std::filesystem::path(cache) / "jlox";
+  }
+  if (const char *home = std::getenv("HOME"); home != nullptr && *home != '\0')
+  {
+    return std::filesystem::path(home) / ".cache" / "jlox";
+  }
+  return std::filesystem::temp_directory_path() / "jlox";
+}
+
+std::uint64_t AstCache::hash(std::string_view source)
+{
+  // multiply and fold eight bytes at a time, the tail is zero padded
+  constexpr std::uint64_t multiplier = 0x9fb21c651e98df25;
+  std::uint64_t hash = 0x243f6a8885a308d3 ^ source.size();
+  std::size_t i{0};
+  for (; i + 8 <= source.size(); i += 8)
+  {
+    hash = std::rotl((hash ^ read_u64(source.data() + i)) * multiplier, 29);
+  }
+  char tail[8] = {};
+  std::memcpy(tail, source.data() + i, source.size() - i);
+  hash = (hash ^ read_u64(tail)) * multiplier;
+  hash ^= hash >> 32;
+  hash *= multiplier;
+  return hash ^ (hash >> 29);
+}
+
+std::filesystem::path AstCache::entry_path(std::uint64_t key) const
+{
+  return m_directory / std::format("{:016x}{}", key, extension);
+}
+
+std::optional<CachedTree> AstCache::load(std::string_view source, StringTable &strings) const
+{
+  std::uint64_t key = hash(source);
+  CachedTree cached;
+  try
+  {
+    cached.m_file = SourceBuffer::open(entry_path(key).string());
+  }
+  catch (const SourceException &)
+  {
+    return std::nullopt;
+  }
+  std::string_view file = cached.m_file.view();
+
+  Header header;
+  if (file.size() < sizeof(header))
+  {
+    return std::nullopt;
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version ||
+      header.header_size != sizeof(Header) || header.node_size != sizeof(FlatExprNode) ||
+      header.token_size != sizeof(Token) || header.source_hash != key || header.source_size != source.size())
+  {
+    return std::nullopt;
+  }
+  Layout layout{header};
+  if (layout.end != file.size() || file.substr(layout.source) != source)
+  {
+    return std::nullopt;
+  }
+
+  FlatExprView &tree = cached.m_tree;
+  tree.nodes = borrow<FlatExprNode>(file, layout.nodes, header.node_count);
+  tree.tokens = borrow<Token>(file, layout.tokens, header.token_count);
+  tree.roots = borrow<ExprIndex>(file, layout.roots, header.root_count);
+  for (const auto &token : tree.tokens)
+  {
+    if (token.type > TokenType::eof || token.offset > source.size() || token.length > source.size() - token.offset)
+    {
+      return std::nullopt;
+    }
+  }
+
+  auto offsets = borrow<std::uint32_t>(file, layout.string_offsets, std::size_t{header.string_count} + 1);
+  std::vector<Symbol> interned;
+  interned.reserve(header.string_count);
+  for (std::size_t i{0}; i < header.string_count; ++i)
+  {
+    if (offsets[i] > offsets[i + 1] || offsets[i + 1] > header.string_bytes)
+    {
+      return std::nullopt;
+    }
+    interned.push_back(strings.intern(file.substr(layout.string_bytes + offsets[i], offsets[i + 1] - offsets[i])));
+  }
+
+  auto values = borrow<StoredValue>(file, layout.values, header.value_count);
+  cached.m_values.reserve(values.size());
+  for (const auto &value : values)
+  {
+    switch (value.type)
+    {
+      case Value::Type::Nil: cached.m_values.push_back(Value::nil()); break;
+      case Value::Type::Bool: cached.m_values.push_back(Value::boolean(value.boolean)); break;
+      case Value::Type::Number: cached.m_values.push_back(Value::number(value.number)); break;
+      case Value::Type::String:
+        if (value.string >= interned.size())
+        {
+          return std::nullopt;
+        }
+        cached.m_values.push_back(Value::string(interned[value.string]));
+        break;
+      default: return std::nullopt;
+    }
+  }
+  tree.values = cached.m_values;
+
+  try
+  {
+    tree.validate();
+  }
+  catch (const LoxException &)
+  {
+    return std::nullopt;
+  }
+  return cached;
+}
+
+bool AstCache::store(std::string_view source, const FlatExpr &tree, const StringTable &interned) const
+{
+  // number the distinct strings in order of first use
+  std::vector<StoredValue> values;
+  values.reserve(tree.values.size());
+  std::vector<Symbol> strings;
+  std::unordered_map<Symbol, std::uint32_t> string_index;
+  std::string string_bytes;
+  std::vector<std::uint32_t> offsets{0};
+  for (const auto &value : tree.values)
+  {
+    StoredValue stored{};
+    stored.type = value.type;
+    switch (value.type)
+    {
+      case Value::Type::Nil: break;
+      case Value::Type::Bool: stored.boolean = value.as.boolean; break;
+      case Value::Type::Number: stored.number = value.as.number; break;
+      case Value::Type::String:
+      {
+        auto [found, added] = string_index.try_emplace(value.as.string, static_cast<std::uint32_t>(strings.size()));
+        if (added)
+        {
+          strings.push_back(value.as.string);
+          string_bytes += interned.view(value.as.string);
+          offsets.push_back(static_cast<std::uint32_t>(string_bytes.size()));
+        }
+        stored.string = found->second;
+        break;
+      }
+    }
+    values.push_back(stored);
+  }
+
+  Header header{};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.header_size = sizeof(Header);
+  header.node_size = sizeof(FlatExprNode);
+  header.token_size = sizeof(Token);
+  header.source_hash = hash(source);
+  header.source_size = source.size();
+  header.node_count = static_cast<std::uint32_t>(tree.nodes.size());
+  header.token_count = static_cast<std::uint32_t>(tree.tokens.size());
+  header.value_count = static_cast<std::uint32_t>(values.size());
+  header.root_count = static_cast<std::uint32_t>(tree.roots.size());
+  header.string_count = static_cast<std::uint32_t>(strings.size());
+  header.string_bytes = static_cast<std::uint32_t>(string_bytes.size());
+  Layout layout{header};
+
+  std::string image(layout.end, '\0');
+  auto put = [&](std::size_t offset, const void *data, std::size_t size) {
+    if (size != 0)
+    {
+      std::memcpy(image.data() + offset, data, size);
+    }
+  };
+  put(0, &header, sizeof(header));
+  put(layout.nodes, tree.nodes.data(), tree.nodes.size() * sizeof(FlatExprNode));
+  put(layout.tokens, tree.tokens.data(), tree.tokens.size() * sizeof(Token));
+  put(layout.values, values.data(), values.size() * sizeof(StoredValue));
+  put(layout.roots, tree.roots.data(), tree.roots.size() * sizeof(ExprIndex));
+  put(layout.string_offsets, offsets.data(), offsets.size() * sizeof(std::uint32_t));
+  put(layout.string_bytes, string_bytes.data(), string_bytes.size());
+  put(layout.source, source.data(), source.size());
+
+  // write a private file and rename it into place, so concurrent runs and
+  // threads never see a half written entry
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+  auto path = entry_path(header.source_hash);
+  auto temporary = path;
+  temporary += std::format(".{}.{}.tmp", ::getpid(), std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+    if (!out.write(image.data(), static_cast<std::streamsize>(image.size())))
+    {
+      std::filesystem::remove(temporary, error);
+      return false;
+    }
+  }
+  std::filesystem::rename(temporary, path, error);
+  if (error)
+  {
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
+
+std::size_t AstCache::clear() const
+{
+  std::size_t removed{0};
+  std::error_code error;
+  for (const auto &entry : std::filesystem::directory_iterator(m_directory, error))
+  {
+    if (entry.is_regular_file(error) && entry.path().extension() == extension)
+    {
+      removed += std::filesystem::remove(entry.path(), error) ? 1 : 0;
+    }
+  }
+  return removed;
+}
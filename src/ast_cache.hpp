@@ -0,0 +1,79 @@
+#pragma once
+
+#include "flat_expr.hpp"
+#include "source.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+/*
+ * On-disk cache of parsed scripts, one file per distinct source text named
+ * after a hash of its content. An entry is the FlatExpr of the whole script
+ * written as a header followed by 8 byte aligned arrays, so a loaded entry
+ * is used in place from the mapped file. Tokens refer to the source by
+ * offset. The source text is stored last and compared on load, so a
+ * different script whose hash collides never gets the entry's tree.
+ */
+/*
+ * A loaded entry. Nodes, tokens and roots are read straight from the mapped
+ * file, only the values are rebuilt because their strings must be interned.
+ * Moving keeps the view valid, the arrays it points to do not move.
+ */
+class CachedTree
+{
+public:
+  [[nodiscard]] const FlatExprView& tree() const
+  {
+    return m_tree;
+  }
+
+private:
+  friend class AstCache;
+
+  SourceBuffer m_file;
+  std::vector<Value> m_values;
+  FlatExprView m_tree;
+};
+
+class AstCache
+{
+public:
+  // bump whenever the layout of the file or of a stored record changes
+  static constexpr std::uint32_t version = 3;
+
+  explicit AstCache(std::filesystem::path directory) : m_directory(std::move(directory))
+  {
+  }
+
+  // $LOX_CACHE_DIR, else $XDG_CACHE_HOME/jlox, else ~/.cache/jlox
+  static std::filesystem::path default_directory();
+
+  // content hash naming the entry, not meant to resist crafted input since
+  // load compares the stored text
+  static std::uint64_t hash(std::string_view source);
+
+  // the cached tree of source with its strings interned into strings, or
+  // nothing when there is no entry or the entry does not fit this build
+  std::optional<CachedTree> load(std::string_view source, StringTable &strings) const;
+
+  // write the tree of source whose strings are interned in interned, returns
+  // false if the entry could not be written
+  bool store(std::string_view source, const FlatExpr &tree, const StringTable &interned) const;
+
+  // delete every entry, returns how many were removed
+  std::size_t clear() const;
+
+  [[nodiscard]] const std::filesystem::path& directory() const
+  {
+    return m_directory;
+  }
+
+private:
+  [[nodiscard]] std::filesystem::path entry_path(std::uint64_t key) const;
+
+  std::filesystem::path m_directory;
+};
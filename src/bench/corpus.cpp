@@ -0,0 +1,125 @@
+#include "bench/corpus.hpp"
+
+#include <random>
+#include <string_view>
+
+namespace
+{
+  constexpr char operators[] = {'+', '-', '*', '/'};
+}
+
+namespace corpus
+{
+  std::string identifiers(std::size_t count)
+  {
+    std::mt19937 random{42};
+    std::uniform_int_distribution<std::size_t> pick{0, std::size(words) - 1};
+    std::string source;
+    for (std::size_t i{0}; i < count; ++i)
+    {
+      source += words[pick(random)];
+      source += (i % 8 == 7) ? '\n' : ' ';
+    }
+    return source;
+  }
+
+  std::string numbers(std::size_t count)
+  {
+    std::mt19937 random{42};
+    std::uniform_int_distribution<int> integer{0, 99999};
+    std::string source;
+    for (std::size_t i{0}; i < count; ++i)
+    {
+      source += std::to_string(integer(random));
+      if (i % 2 == 1)
+      {
+        source += '.';
+        source += std::to_string(integer(random));
+      }
+      source += (i % 8 == 7) ? "\n" : std::string{' ', operators[i % std::size(operators)], ' '};
+    }
+    source += "0\n";
+    return source;
+  }
+
+  std::string strings(std::size_t count)
+  {
+    std::mt19937 random{42};
+    std::uniform_int_distribution<std::size_t> pick{0, std::size(words) - 1};
+    std::string source;
+    for (std::size_t i{0}; i < count; ++i)
+    {
+      source += '"';
+      source += words[pick(random)];
+      source += ' ';
+      source += words[pick(random)];
+      source += '"';
+      source += (i % 8 == 7) ? "\n" : " + ";
+    }
+    source += "\"\"\n";
+    return source;
+  }
+
+  std::string comments(std::size_t count)
+  {
+    std::string source;
+    for (std::size_t i{0}; i < count; ++i)
+    {
+      source += "// step ";
+      source += std::to_string(i);
+      source += " of the generated script, kept for reference\n";
+      source += "1 + 2\n";
+    }
+    return source;
+  }
+
+  std::string comments_and_strings(std::size_t count)
+  {
+    std::string source;
+    for (std::size_t i{0}; i < count; ++i)
+    {
+      source += "    // generated by the exporter, do not edit this line by hand\n";
+      source += "    \"" + std::string(120, 'x') + "\nsecond line of the literal\" + 1\n";
+    }
+    return source;
+  }
+
+  std::string wide_expressions(std::size_t lines, std::size_t width)
+  {
+    // cycle through the binary operators of every precedence level
+    constexpr std::string_view binary[] = {" + ", " * ", " == ", " - ", " / ", " < ", " != ", " >= "};
+    std::string source;
+    for (std::size_t line{0}; line < lines; ++line)
+    {
+      for (std::size_t i{0}; i < width; ++i)
+      {
+        if (i > 0)
+        {
+          source += binary[(line + i) % std::size(binary)];
+        }
+        source += std::to_string(i % 100);
+      }
+      source += '\n';
+    }
+    return source;
+  }
+
+  std::string nested_expressions(std::size_t lines, std::size_t depth)
+  {
+    std::string source;
+    for (std::size_t line{0}; line < lines; ++line)
+    {
+      for (std::size_t i{0}; i < depth; ++i)
+      {
+        source += (i % 2 == 0) ? "(" : "-(";
+      }
+      source += "1";
+      for (std::size_t i{0}; i < depth; ++i)
+      {
+        source += (i % 3 == 0) ? " + 2)" : ")";
+      }
+      source += '\n';
+    }
+    return source;
+  }
+}
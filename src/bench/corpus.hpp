@@ -0,0 +1,50 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/*
+ * Synthetic sources for the benchmarks. Every generator is deterministic, so
+ * numbers from different runs and revisions are comparable.
+ */
+namespace corpus
+{
+  // keywords and identifiers which share a prefix with one
+  inline constexpr std::string_view words[] = {
+    "and", "class", "else", "false", "for", "fun", "if", "nil", "or", "print", "return",
+    "super", "this", "true", "var", "while", "count", "value", "total", "index", "result",
+    "format", "tree", "node", "offset", "iffy", "classic", "variable", "whiles", "fork",
+  };
+
+  // keywords mixed with identifiers sharing their prefixes
+  std::string identifiers(std::size_t count);
+
+  // integer and decimal literals joined by arithmetic operators
+  std::string numbers(std::size_t count);
+
+  // short string literals joined by +
+  std::string strings(std::size_t count);
+
+  // line comments between short expressions
+  std::string comments(std::size_t count);
+
+  // mostly comments and long string literals, like machine generated scripts
+  std::string comments_and_strings(std::size_t count);
+
+  // one expression per line, each a chain of width operands at every precedence level
+  std::string wide_expressions(std::size_t lines, std::size_t width);
+
+  // one expression per line, each nested depth groupings and unary operators deep
+  std::string nested_expressions(std::size_t lines, std::size_t depth);
+}
+
+// report bytes/s and tokens/s for work done on every iteration
+inline void set_throughput(benchmark::State &state, std::size_t bytes, std::size_t tokens)
+{
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes));
+  state.counters["tokens/s"] =
+    benchmark::Counter(static_cast<double>(state.iterations() * tokens), benchmark::Counter::kIsRate);
+}
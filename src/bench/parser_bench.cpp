@@ -0,0 +1,85 @@
+#include "bench/corpus.hpp"
+#include "compilation_context.hpp"
+#include "expr.hpp"
+#include "lexer.hpp"
+#include "output_buffer.hpp"
+#include "parser.hpp"
+#include "print.hpp"
+#include "value.hpp"
+
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <ostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+  std::string wide(std::size_t lines)
+  {
+    return corpus::wide_expressions(lines, 64);
+  }
+
+  std::string nested(std::size_t lines)
+  {
+    return corpus::nested_expressions(lines, 256);
+  }
+
+  // tokens are scanned up front, so only the parser is measured
+  void BM_Parse(benchmark::State &state, std::string (*generate)(std::size_t))
+  {
+    std::string source = generate(state.range(0));
+    StringTable strings;
+    CompilationContext compilation{strings};
+    TokenList tokens = Scanner{source, compilation}.scan_tokens();
+    for (auto _ : state)
+    {
+      TokenListStream stream{tokens};
+      Parser parser{stream, compilation};
+      while (!parser.is_at_end())
+      {
+        benchmark::DoNotOptimize(parser.parse());
+      }
+    }
+    set_throughput(state, source.size(), tokens.tokens.size());
+  }
+
+  void BM_Print(benchmark::State &state, std::string (*generate)(std::size_t))
+  {
+    std::string source = generate(state.range(0));
+    StringTable strings;
+    CompilationContext compilation{strings};
+    TokenList tokens = Scanner{source, compilation}.scan_tokens();
+    TokenListStream stream{tokens};
+    Parser parser{stream, compilation};
+    std::vector<Expr *> trees;
+    while (!parser.is_at_end())
+    {
+      trees.push_back(parser.parse());
+    }
+
+    // the whole output path, trees go to /dev/null through the same buffer
+    // main writes stdout with
+    int null = ::open("/dev/null", O_WRONLY);
+    OutputBuffer buffer{null};
+    std::ostream out{&buffer};
+    AstPrinter printer{tokens};
+    for (auto _ : state)
+    {
+      for (Expr *tree : trees)
+      {
+        printer.print(*tree, out);
+        out.rdbuf()->sputc('\n');
+      }
+    }
+    out.flush();
+    ::close(null);
+    set_throughput(state, source.size(), tokens.tokens.size());
+  }
+}
+
+BENCHMARK_CAPTURE(BM_Parse, wide, wide)->Arg(1 << 6)->Arg(1 << 10);
+BENCHMARK_CAPTURE(BM_Parse, nested, nested)->Arg(1 << 6)->Arg(1 << 10);
+BENCHMARK_CAPTURE(BM_Print, wide, wide)->Arg(1 << 6)->Arg(1 << 10);
+BENCHMARK_CAPTURE(BM_Print, nested, nested)->Arg(1 << 6)->Arg(1 << 10);
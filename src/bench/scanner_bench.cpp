@@ -0,0 +1,90 @@
+#include "bench/corpus.hpp"
+#include "compilation_context.hpp"
+#include "lexer.hpp"
+
+#include <benchmark/benchmark.h>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+  // the lookup the scanner used before keyword_type
+  TokenType map_keyword_type(std::string_view text)
+  {
+    static std::map<std::string, TokenType> keywords
+    {
+      {"and", TokenType::AND}, {"class", TokenType::CLASS}, {"else", TokenType::ELSE},
+      {"false", TokenType::FALSE}, {"for", TokenType::FOR}, {"fun", TokenType::FUN},
+      {"if", TokenType::IF}, {"nil", TokenType::NIL}, {"or", TokenType::OR},
+      {"print", TokenType::PRINT}, {"return", TokenType::RETURN}, {"super", TokenType::SUPER},
+      {"this", TokenType::THIS}, {"true", TokenType::TRUE}, {"var", TokenType::VAR},
+      {"while", TokenType::WHILE},
+    };
+    std::string str{text};
+    if (keywords.contains(str))
+    {
+      return keywords[str];
+    }
+    return TokenType::IDENTIFIER;
+  }
+
+  template<TokenType (*Classify)(std::string_view)>
+  void BM_KeywordLookup(benchmark::State &state)
+  {
+    for (auto _ : state)
+    {
+      for (auto word : corpus::words)
+      {
+        benchmark::DoNotOptimize(Classify(word));
+      }
+    }
+    state.SetItemsProcessed(state.iterations() * std::size(corpus::words));
+  }
+
+  TokenType switch_keyword_type(std::string_view text)
+  {
+    return keyword_type(text);
+  }
+
+  void BM_ScanTokens(benchmark::State &state, std::string (*generate)(std::size_t))
+  {
+    std::string source = generate(state.range(0));
+    std::size_t tokens = 0;
+    StringTable strings;
+    CompilationContext compilation{strings};
+    for (auto _ : state)
+    {
+      Scanner scanner{source, compilation};
+      auto list = scanner.scan_tokens();
+      tokens = list.tokens.size();
+      benchmark::DoNotOptimize(list.tokens.data());
+    }
+    set_throughput(state, source.size(), tokens);
+  }
+
+  void BM_ScanCommentsAndStrings(benchmark::State &state)
+  {
+    std::string source = corpus::comments_and_strings(1 << 12);
+    const auto &kernels = ScanKernels::get(static_cast<ScanKernels::Isa>(state.range(0)));
+    state.SetLabel(to_string(kernels.isa));
+    StringTable strings;
+    CompilationContext compilation{strings};
+    for (auto _ : state)
+    {
+      Scanner scanner{source, compilation, kernels};
+      auto list = scanner.scan_tokens();
+      benchmark::DoNotOptimize(list.tokens.data());
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+  }
+}
+
+BENCHMARK(BM_KeywordLookup<map_keyword_type>)->Name("BM_KeywordLookup/map");
+BENCHMARK(BM_KeywordLookup<switch_keyword_type>)->Name("BM_KeywordLookup/switch");
+BENCHMARK_CAPTURE(BM_ScanTokens, identifiers, corpus::identifiers)->Arg(1 << 12)->Arg(1 << 16);
+BENCHMARK_CAPTURE(BM_ScanTokens, numbers, corpus::numbers)->Arg(1 << 12)->Arg(1 << 16);
+BENCHMARK_CAPTURE(BM_ScanTokens, strings, corpus::strings)->Arg(1 << 12)->Arg(1 << 16);
+BENCHMARK_CAPTURE(BM_ScanTokens, comments, corpus::comments)->Arg(1 << 12)->Arg(1 << 16);
+BENCHMARK(BM_ScanCommentsAndStrings)->DenseRange(0, 2);
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "nan_value.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class OpCode : std::uint8_t
+{
+  CONSTANT,      // [index: u8] push constants[index]
+  CONSTANT_LONG, // [index: u24] push constants[index]
+  NIL,
+  TRUE,
+  FALSE,
+  EQUAL,
+  NOT_EQUAL,
+  GREATER,
+  GREATER_EQUAL,
+  LESS,
+  LESS_EQUAL,
+  ADD,
+  SUBTRACT,
+  MULTIPLY,
+  DIVIDE,
+  NOT,
+  NEGATE,
+  RETURN, // pop the result and stop
+};
+
+constexpr std::size_t opcode_count = static_cast<std::size_t>(OpCode::RETURN) + 1;
+
+/*
+ * Compiled bytecode of one expression. The source offsets of the tokens
+ * instructions were compiled from are run length encoded: every entry marks
+ * the offset from which instructions belong to a new token.
+ */
+struct Chunk
+{
+  struct SourceStart
+  {
+    std::uint32_t offset;
+    std::uint32_t source; // offset of the token in the source
+  };
+
+  std::vector<std::uint8_t> code;
+  std::vector<NanValue> constants;
+  std::vector<SourceStart> sources;
+  std::size_t max_stack{0}; // deepest the VM stack gets while running this chunk
+
+  void write(std::uint8_t byte, std::uint32_t source)
+  {
+    if (sources.empty() || sources.back().source != source)
+    {
+      sources.push_back({static_cast<std::uint32_t>(code.size()), source});
+    }
+    code.push_back(byte);
+  }
+
+  void write(OpCode op, std::uint32_t source)
+  {
+    write(static_cast<std::uint8_t>(op), source);
+  }
+
+  std::size_t add_constant(NanValue value)
+  {
+    constants.push_back(value);
+    return constants.size() - 1;
+  }
+
+  // source offset of the token the instruction at offset was compiled from
+  [[nodiscard]] std::uint32_t source_at(std::size_t offset) const
+  {
+    auto next = std::upper_bound(sources.begin(), sources.end(), offset,
+                                 [](std::size_t offset, const SourceStart &start) { return offset < start.offset; });
+    return next == sources.begin() ? 0 : std::prev(next)->source;
+  }
+
+  void clear()
+  {
+    code.clear();
+    constants.clear();
+    sources.clear();
+    max_stack = 0;
+  }
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "source_map.hpp"
 #include <iostream>
 #include <string_view>
 
@@ -9,23 +10,31 @@ constexpr int EX_USAGE = 64;
 constexpr int EX_DATAERR = 65;
 // An input file did not exist or was not readable.
 constexpr int EX_NOINPUT = 66;
+// An internal software error has been detected (used for runtime errors)
+constexpr int EX_SOFTWARE = 70;
 
+// The flag and streams are per thread, so batch mode can run scripts side
+// by side and keep each one's results and diagnostics apart. Compile errors
+// are collected by the CompilationContext of each source instead.
 namespace Error
 {
-  // hadError is set whenever there is any error during compilation process
-  inline bool hadError = false;
+  // hadRuntimeError is set when evaluating an expression failed
+  inline thread_local bool hadRuntimeError = false;
 }
 
-inline void report(int line, std::string_view where, std::string_view message)
+namespace Output
 {
-  std::cerr << "[line " << line << "] Error" << where << ": " << message << "\n";
-  Error::hadError = true;
+  // where printed trees and values go
+  inline thread_local std::ostream *results = &std::cout;
+  // where compile and runtime errors go
+  inline thread_local std::ostream *diagnostics = &std::cerr;
 }
 
-// writes a error message to stderr
-inline void error(int line, std::string_view message)
+// writes a runtime error message to stderr
+inline void runtime_error(SourcePosition position, std::string_view message)
 {
-  report(line, "", message);
+  *Output::diagnostics << message << "\n[line " << position.line << ", column " << position.column << "]\n";
+  Error::hadRuntimeError = true;
 }
 
 struct LoxException : public std::runtime_error
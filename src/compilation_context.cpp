@@ -0,0 +1,23 @@
+#include "compilation_context.hpp"
+
+#include <iterator>
+#include <utility>
+
+void Diagnostics::append(Diagnostics &&other)
+{
+  m_pending.insert(m_pending.end(), std::make_move_iterator(other.m_pending.begin()),
+                   std::make_move_iterator(other.m_pending.end()));
+  m_error_count += other.m_error_count;
+  other.clear();
+}
+
+void Diagnostics::flush(std::ostream &out, const SourceMap &source_map)
+{
+  for (const Diagnostic &diagnostic : m_pending)
+  {
+    SourcePosition position = source_map.position(diagnostic.offset);
+    out << "[line " << position.line << ", column " << position.column << "] Error" << diagnostic.where << ": "
+        << diagnostic.message << "\n";
+  }
+  m_pending.clear();
+}
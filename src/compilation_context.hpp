@@ -0,0 +1,109 @@
+#pragma once
+
+#include "source_map.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * One error found while scanning or parsing
+ */
+struct Diagnostic
+{
+  std::size_t offset; // where in the source the error was found
+  std::string where; // " at 'lexeme'", " at end" or empty
+  std::string message;
+};
+
+/*
+ * Collects the errors of one compilation. Nothing is written until flush(),
+ * the count keeps including flushed errors.
+ */
+class Diagnostics
+{
+public:
+  void error(std::size_t offset, std::string_view where, std::string_view message)
+  {
+    m_pending.push_back(Diagnostic{offset, std::string(where), std::string(message)});
+    ++m_error_count;
+  }
+
+  void error(std::size_t offset, std::string_view message)
+  {
+    error(offset, "", message);
+  }
+
+  // take over the errors of other, after the ones already here
+  void append(Diagnostics &&other);
+
+  // write the pending errors as "[line N, column C] Error...: message" and
+  // drop them, positions are looked up in source_map
+  void flush(std::ostream &out, const SourceMap &source_map);
+
+  [[nodiscard]] const std::vector<Diagnostic>& pending() const
+  {
+    return m_pending;
+  }
+
+  [[nodiscard]] std::size_t error_count() const
+  {
+    return m_error_count;
+  }
+
+  [[nodiscard]] bool had_error() const
+  {
+    return m_error_count > 0;
+  }
+
+  // forget every error, flushed or not
+  void clear()
+  {
+    m_pending.clear();
+    m_error_count = 0;
+  }
+
+private:
+  std::vector<Diagnostic> m_pending;
+  std::size_t m_error_count{0};
+};
+
+/*
+ * Everything scanning and parsing one source reports to or shares: the
+ * diagnostics, the table string literals are interned into and the map
+ * that turns their offsets into lines. Scanners and parsers touch no global
+ * state, so sources with their own contexts can be compiled on different
+ * threads at once.
+ */
+class CompilationContext
+{
+public:
+  explicit CompilationContext(StringTable &strings) : m_strings(strings)
+  {
+  }
+
+  CompilationContext(const CompilationContext &) = delete;
+  CompilationContext &operator=(const CompilationContext &) = delete;
+
+  StringTable& strings()
+  {
+    return m_strings;
+  }
+
+  Diagnostics& diagnostics()
+  {
+    return m_diagnostics;
+  }
+
+  SourceMap& source_map()
+  {
+    return m_source_map;
+  }
+
+private:
+  StringTable &m_strings;
+  Diagnostics m_diagnostics;
+  SourceMap m_source_map;
+};
@@ -0,0 +1,102 @@
+#include "compiler.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+void Compiler::compile(Expr &expr, Chunk &chunk)
+{
+  chunk.clear();
+  m_chunk = &chunk;
+  m_depth = 0;
+  visit(expr);
+  emit(OpCode::RETURN, m_chunk->sources.empty() ? 0 : m_chunk->sources.back().source);
+  m_chunk = nullptr;
+}
+
+void Compiler::emit(OpCode op, std::uint32_t source)
+{
+  m_chunk->write(op, source);
+}
+
+void Compiler::emit_constant(NanValue value, std::uint32_t source)
+{
+  std::size_t index = m_chunk->add_constant(value);
+  if (index <= UINT8_MAX)
+  {
+    emit(OpCode::CONSTANT, source);
+    m_chunk->write(static_cast<std::uint8_t>(index), source);
+    return;
+  }
+  if (index > 0xffffff)
+  {
+    throw LoxException("Too many constants in one chunk.");
+  }
+  emit(OpCode::CONSTANT_LONG, source);
+  m_chunk->write(static_cast<std::uint8_t>(index), source);
+  m_chunk->write(static_cast<std::uint8_t>(index >> 8), source);
+  m_chunk->write(static_cast<std::uint8_t>(index >> 16), source);
+}
+
+void Compiler::push()
+{
+  ++m_depth;
+  m_chunk->max_stack = std::max(m_chunk->max_stack, m_depth);
+}
+
+void Compiler::pop()
+{
+  --m_depth;
+}
+
+void Compiler::visit_binary(Binary &expr)
+{
+  visit(*expr.left);
+  visit(*expr.right);
+
+  std::uint32_t source = expr.op.offset;
+  switch (expr.op.type)
+  {
+    case TokenType::PLUS: emit(OpCode::ADD, source); break;
+    case TokenType::MINUS: emit(OpCode::SUBTRACT, source); break;
+    case TokenType::STAR: emit(OpCode::MULTIPLY, source); break;
+    case TokenType::SLASH: emit(OpCode::DIVIDE, source); break;
+    case TokenType::GREATER: emit(OpCode::GREATER, source); break;
+    case TokenType::GREATER_EQUAL: emit(OpCode::GREATER_EQUAL, source); break;
+    case TokenType::LESS: emit(OpCode::LESS, source); break;
+    case TokenType::LESS_EQUAL: emit(OpCode::LESS_EQUAL, source); break;
+    case TokenType::EQAUL_EQUAL: emit(OpCode::EQUAL, source); break;
+    case TokenType::BANG_EQUAL: emit(OpCode::NOT_EQUAL, source); break;
+    default: throw LoxException("Unknown binary operator.");
+  }
+  pop();
+}
+
+void Compiler::visit_grouping(Grouping &expr)
+{
+  visit(*expr.expression);
+}
+
+void Compiler::visit_literal(Literal &expr)
+{
+  std::uint32_t source = expr.value.offset;
+  switch (expr.constant.type)
+  {
+    case Value::Type::Nil: emit(OpCode::NIL, source); break;
+    case Value::Type::Bool: emit(expr.constant.as.boolean ? OpCode::TRUE : OpCode::FALSE, source); break;
+    default: emit_constant(NanValue::from(expr.constant), source); break;
+  }
+  push();
+}
+
+void Compiler::visit_unary(Unary &expr)
+{
+  visit(*expr.right);
+
+  std::uint32_t source = expr.op.offset;
+  switch (expr.op.type)
+  {
+    case TokenType::MINUS: emit(OpCode::NEGATE, source); break;
+    case TokenType::BANG: emit(OpCode::NOT, source); break;
+    default: throw LoxException("Unknown unary operator.");
+  }
+}
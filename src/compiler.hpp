@@ -0,0 +1,32 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "expr.hpp"
+#include "lexer.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Lowers an expression tree to stack bytecode. Operands are emitted before
+ * their operator, so the tree is flattened in post order.
+ */
+class Compiler : public ExprVisitor<Compiler, void>
+{
+public:
+  // compile expr into chunk, replacing its previous contents
+  void compile(Expr &expr, Chunk &chunk);
+
+  void visit_binary(Binary &expr);
+  void visit_grouping(Grouping &expr);
+  void visit_literal(Literal &expr);
+  void visit_unary(Unary &expr);
+
+private:
+  void emit(OpCode op, std::uint32_t source);
+  void emit_constant(NanValue value, std::uint32_t source);
+  void push();
+  void pop();
+
+  Chunk *m_chunk{nullptr};
+  std::size_t m_depth{0};
+};
@@ -0,0 +1,84 @@
+#pragma once
+// Generated by generate_ast from expr_nodes.hpp, do not edit.
+
+#include "common.hpp"
+#include "expr_nodes.hpp"
+#include "lexer.hpp"
+#include "value.hpp"
+#include <utility>
+
+static_assert(expr_nodes_hash == 0x41619a3c4872a979, "expr.hpp is out of date, build the genast target");
+
+struct Binary;
+struct Grouping;
+struct Literal;
+struct Unary;
+
+struct Expr
+{
+  ExprKind kind;
+};
+
+struct Binary : Expr
+{
+  explicit Binary (Expr* left, Token op, Expr* right)
+    : Expr{ExprKind::Binary}, left{std::move(left)}, op{std::move(op)}, right{std::move(right)}
+  {
+  }
+
+  Expr* left;
+  Token op;
+  Expr* right;
+};
+
+struct Grouping : Expr
+{
+  explicit Grouping (Expr* expression)
+    : Expr{ExprKind::Grouping}, expression{std::move(expression)}
+  {
+  }
+
+  Expr* expression;
+};
+
+struct Literal : Expr
+{
+  explicit Literal (Token value, Value constant)
+    : Expr{ExprKind::Literal}, value{std::move(value)}, constant{std::move(constant)}
+  {
+  }
+
+  Token value;
+  Value constant;
+};
+
+struct Unary : Expr
+{
+  explicit Unary (Token op, Expr* right)
+    : Expr{ExprKind::Unary}, op{std::move(op)}, right{std::move(right)}
+  {
+  }
+
+  Token op;
+  Expr* right;
+};
+
+/*
+ * CRTP visitor: Derived implements R visit_<node>(Node &expr) for every node
+ */
+template<typename Derived, typename R>
+struct ExprVisitor
+{
+  R visit(Expr &expr)
+  {
+    auto &self = static_cast<Derived &>(*this);
+    switch (expr.kind)
+    {
+      case ExprKind::Binary: return self.visit_binary(static_cast<Binary &>(expr));
+      case ExprKind::Grouping: return self.visit_grouping(static_cast<Grouping &>(expr));
+      case ExprKind::Literal: return self.visit_literal(static_cast<Literal &>(expr));
+      case ExprKind::Unary: return self.visit_unary(static_cast<Unary &>(expr));
+    }
+    throw LoxException("Unknown expr kind");
+  }
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/*
+ * Nodes of the expression tree. Every Node(Name, Fields) entry lists its
+ * fields as Field(Type, name). generate_ast reads this list to emit expr.hpp
+ * and flat_expr.hpp, so after changing it rebuild the genast target.
+ * Literal::constant is the value of the token, decoded once by the parser.
+ */
+#define ExprFunc(Node, Field) \
+        Node(Binary,   Field(Expr*, left) Field(Token, op) Field(Expr*, right)) \
+        Node(Grouping, Field(Expr*, expression)) \
+        Node(Literal,  Field(Token, value) Field(Value, constant)) \
+        Node(Unary,    Field(Token, op) Field(Expr*, right))
+
+#define GenExprKind(Name, Fields) Name ,
+#define GenExprCount(Name, Fields) + 1
+#define GenExprKindStr(Name, Fields) case ExprKind::Name: return #Name; break;
+#define GenExprNoField(Type, name)
+
+enum class ExprKind : std::uint8_t
+{
+  ExprFunc(GenExprKind, GenExprNoField)
+};
+
+constexpr std::size_t expr_kind_count = 0 ExprFunc(GenExprCount, GenExprNoField);
+
+// FNV-1a hash of every node with the types and names of its fields. The
+// generated headers assert on the value they were generated from, so a
+// change to any field is noticed, not just a node added or removed.
+#define GenExprSignature(Name, Fields) #Name "(" Fields ")"
+#define GenExprFieldSignature(Type, name) #Type " " #name ";"
+
+constexpr std::uint64_t expr_nodes_hash = [] {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (char c : std::string_view(ExprFunc(GenExprSignature, GenExprFieldSignature)))
+  {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  }
+  return hash;
+}();
+
+constexpr const char* to_string(ExprKind kind)
+{
+  switch (kind)
+  {
+    ExprFunc(GenExprKindStr, GenExprNoField)
+  }
+  return "Unknown Expr Kind";
+}
@@ -0,0 +1,278 @@
+#pragma once
+// Generated by generate_ast from expr_nodes.hpp, do not edit.
+
+#include "arena.hpp"
+#include "common.hpp"
+#include "expr.hpp"
+#include "lexer.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+static_assert(expr_nodes_hash == 0x41619a3c4872a979, "flat_expr.hpp is out of date, build the genast target");
+
+using ExprIndex = std::uint32_t;
+
+struct FlatExprNode
+{
+  ExprKind kind;
+  std::uint32_t token; // index into FlatExpr::tokens
+  ExprIndex children[2];
+};
+
+struct FlatBinary
+{
+  ExprIndex left;
+  const Token &op;
+  ExprIndex right;
+};
+
+struct FlatGrouping
+{
+  ExprIndex expression;
+};
+
+struct FlatLiteral
+{
+  const Token &value;
+  const Value &constant;
+};
+
+struct FlatUnary
+{
+  const Token &op;
+  ExprIndex right;
+};
+
+// A flat tree owns its arrays, or only looks at arrays stored elsewhere such as a mapped file
+template<typename T> using OwnedArray = std::vector<T>;
+template<typename T> using BorrowedArray = std::span<const T>;
+
+template<template<typename> class Array>
+struct BasicFlatExpr
+{
+  static constexpr std::uint32_t no_index = UINT32_MAX;
+
+  Array<FlatExprNode> nodes;
+  Array<Token> tokens;
+  Array<Value> values;
+  Array<ExprIndex> roots; // top level expressions in insertion order
+
+  ExprIndex add_binary(ExprIndex left, Token op, ExprIndex right)
+  {
+    tokens.push_back(op);
+    nodes.push_back(FlatExprNode{ExprKind::Binary, static_cast<std::uint32_t>(tokens.size() - 1), {left, right}});
+    return static_cast<ExprIndex>(nodes.size() - 1);
+  }
+
+  [[nodiscard]] FlatBinary binary(ExprIndex index) const
+  {
+    const auto &node = nodes[index];
+    return FlatBinary{node.children[0], tokens[node.token], node.children[1]};
+  }
+
+  ExprIndex add_grouping(ExprIndex expression)
+  {
+    nodes.push_back(FlatExprNode{ExprKind::Grouping, no_index, {expression, no_index}});
+    return static_cast<ExprIndex>(nodes.size() - 1);
+  }
+
+  [[nodiscard]] FlatGrouping grouping(ExprIndex index) const
+  {
+    const auto &node = nodes[index];
+    return FlatGrouping{node.children[0]};
+  }
+
+  ExprIndex add_literal(Token value, Value constant)
+  {
+    tokens.push_back(value);
+    values.push_back(constant);
+    nodes.push_back(FlatExprNode{ExprKind::Literal, static_cast<std::uint32_t>(tokens.size() - 1), {static_cast<std::uint32_t>(values.size() - 1), no_index}});
+    return static_cast<ExprIndex>(nodes.size() - 1);
+  }
+
+  [[nodiscard]] FlatLiteral literal(ExprIndex index) const
+  {
+    const auto &node = nodes[index];
+    return FlatLiteral{tokens[node.token], values[node.children[0]]};
+  }
+
+  ExprIndex add_unary(Token op, ExprIndex right)
+  {
+    tokens.push_back(op);
+    nodes.push_back(FlatExprNode{ExprKind::Unary, static_cast<std::uint32_t>(tokens.size() - 1), {right, no_index}});
+    return static_cast<ExprIndex>(nodes.size() - 1);
+  }
+
+  [[nodiscard]] FlatUnary unary(ExprIndex index) const
+  {
+    const auto &node = nodes[index];
+    return FlatUnary{tokens[node.token], node.children[0]};
+  }
+
+  // calls visitor.visit_<kind>(index, view) for the node at index
+  template<typename Visitor>
+  decltype(auto) visit(ExprIndex index, Visitor &visitor) const
+  {
+    switch (nodes[index].kind)
+    {
+      case ExprKind::Binary: return visitor.visit_binary(index, binary(index));
+      case ExprKind::Grouping: return visitor.visit_grouping(index, grouping(index));
+      case ExprKind::Literal: return visitor.visit_literal(index, literal(index));
+      case ExprKind::Unary: return visitor.visit_unary(index, unary(index));
+    }
+    throw LoxException("Unknown expr kind");
+  }
+
+  [[nodiscard]] std::size_t size() const
+  {
+    return nodes.size();
+  }
+
+  // throws LoxException unless every index is in range and every child precedes
+  // its parent within the nodes of the same root
+  void validate() const
+  {
+    auto check = [](std::size_t index, std::size_t begin, std::size_t end) {
+      if (index < begin || index >= end)
+      {
+        throw LoxException("FlatExpr index out of range");
+      }
+    };
+    std::size_t first{0};
+    for (auto root : roots)
+    {
+      check(root, first, nodes.size());
+      for (std::size_t index{first}; index <= root; ++index)
+      {
+        const auto &node = nodes[index];
+        switch (node.kind)
+        {
+          case ExprKind::Binary:
+            check(node.children[0], first, index);
+            check(node.children[1], first, index);
+            check(node.token, 0, tokens.size());
+            break;
+          case ExprKind::Grouping:
+            check(node.children[0], first, index);
+            break;
+          case ExprKind::Literal:
+            check(node.token, 0, tokens.size());
+            check(node.children[0], 0, values.size());
+            break;
+          case ExprKind::Unary:
+            check(node.children[0], first, index);
+            check(node.token, 0, tokens.size());
+            break;
+          default: throw LoxException("Unknown expr kind");
+        }
+      }
+      first = std::size_t{root} + 1;
+    }
+  }
+
+  // the same tree without ownership, valid while this one is left unchanged
+  [[nodiscard]] BasicFlatExpr<BorrowedArray> view() const
+  {
+    return {nodes, tokens, values, roots};
+  }
+};
+
+using FlatExpr = BasicFlatExpr<OwnedArray>;
+using FlatExprView = BasicFlatExpr<BorrowedArray>;
+
+// Appends pointer linked Expr trees to a FlatExpr in post order
+struct FlatExprBuilder : ExprVisitor<FlatExprBuilder, ExprIndex>
+{
+  explicit FlatExprBuilder(FlatExpr &tree) : m_tree(tree)
+  {
+  }
+
+  ExprIndex append(Expr &expr)
+  {
+    auto root = visit(expr);
+    m_tree.roots.push_back(root);
+    return root;
+  }
+
+  ExprIndex visit_binary(Binary &expr)
+  {
+    auto left = visit(*expr.left);
+    auto right = visit(*expr.right);
+    return m_tree.add_binary(left, expr.op, right);
+  }
+  ExprIndex visit_grouping(Grouping &expr)
+  {
+    auto expression = visit(*expr.expression);
+    return m_tree.add_grouping(expression);
+  }
+  ExprIndex visit_literal(Literal &expr)
+  {
+    return m_tree.add_literal(expr.value, expr.constant);
+  }
+  ExprIndex visit_unary(Unary &expr)
+  {
+    auto right = visit(*expr.right);
+    return m_tree.add_unary(expr.op, right);
+  }
+
+private:
+  FlatExpr &m_tree;
+};
+
+// Rebuilds the pointer linked trees of a FlatExpr one top level expression at a time.
+// Trees from outside the process must pass validate() first.
+class FlatExprInflater
+{
+public:
+  explicit FlatExprInflater(FlatExprView tree) : m_tree(tree)
+  {
+  }
+
+  // tree of roots[root] allocated in arena, its nodes are the ones appended after the
+  // previous root
+  Expr *inflate(std::size_t root, Arena &arena)
+  {
+    m_first = root == 0 ? 0 : std::size_t{m_tree.roots[root - 1]} + 1;
+    std::size_t last = m_tree.roots[root];
+    m_built.resize(last - m_first + 1);
+    for (std::size_t index{m_first}; index <= last; ++index)
+    {
+      m_built[index - m_first] = build(static_cast<ExprIndex>(index), arena);
+    }
+    return m_built.back();
+  }
+
+private:
+  Expr *build(ExprIndex index, Arena &arena)
+  {
+    switch (m_tree.nodes[index].kind)
+    {
+      case ExprKind::Binary:
+      {
+        auto view = m_tree.binary(index);
+        return arena.make<Binary>(m_built[view.left - m_first], view.op, m_built[view.right - m_first]);
+      }
+      case ExprKind::Grouping:
+      {
+        auto view = m_tree.grouping(index);
+        return arena.make<Grouping>(m_built[view.expression - m_first]);
+      }
+      case ExprKind::Literal:
+      {
+        auto view = m_tree.literal(index);
+        return arena.make<Literal>(view.value, view.constant);
+      }
+      case ExprKind::Unary:
+      {
+        auto view = m_tree.unary(index);
+        return arena.make<Unary>(view.op, m_built[view.right - m_first]);
+      }
+    }
+    throw LoxException("Unknown expr kind");
+  }
+
+  FlatExprView m_tree;
+  std::vector<Expr *> m_built; // nodes of the current root, from its first node on
+  std::size_t m_first{0};
+};
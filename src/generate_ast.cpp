@@ -1,4 +1,6 @@
 #include "common.hpp"
+#include "expr_nodes.hpp"
+#include <cstdint>
 #include <iostream>
 #include <iterator>
 #include <string>
@@ -76,18 +78,73 @@ private:
   std::ostream_iterator<char> writer_iterator;
 };
 
+std::string class_name_of(const std::string &type)
+{
+  return trim(type.substr(0, type.find_first_of(':')));
+}
+
+// split "Name : Type name, Type name" into its fields
+std::vector<std::string> split_fields(const std::string &type)
+{
+  std::string_view sv(type);
+
+  // Find the first ':' and remove everything up to that point if it exists
+  auto colon_pos = sv.find_first_of(':');
+  if (colon_pos != std::string_view::npos) {
+    sv.remove_prefix(colon_pos + 1);
+  }
+
+  std::vector<std::string> fields;
+
+  // extract the name of derived classes
+  do {
+    // Find the next ',' or the end of the string view
+    auto comma_pos = sv.find_first_of(',');
+
+    // Extract and trim the substring up to the comma (or to the end if no comma found)
+    std::string current_type = trim(std::string(sv.substr(0, comma_pos)));
+    fields.emplace_back(current_type);
+
+    // Remove the processed part of the string view
+    if (comma_pos != std::string_view::npos) {
+      sv.remove_prefix(comma_pos + 1);
+    } else {
+      sv.remove_prefix(sv.size()); // Reached the end
+    }
+
+  } while (!sv.empty());
+
+  return fields;
+}
+
+std::string field_type(const std::string &field)
+{
+  return trim(field.substr(0, field.find_last_of(' ')));
+}
+
+std::string field_name(const std::string &field)
+{
+  return field.substr(field.find_last_of(' ') + 1);
+}
+
 void generate_header(const std::string &output_dir, const std::string &base_name,
-    const std::vector<std::string> &types)
+    const std::vector<std::string> &types, std::uint64_t nodes_hash)
 {
   std::string file_name = std::format("{}/{}.hpp", output_dir, ::to_lower(base_name));
   FileWriter writer {file_name, std::ios::out};
 
   // Add header guard and needed headers
   writer.write_line("#pragma once");
+  writer.write_line("// Generated by generate_ast from {}_nodes.hpp, do not edit.", ::to_lower(base_name));
   writer.new_line();
+  writer.write_line("#include \"common.hpp\"");
+  writer.write_line("#include \"{}_nodes.hpp\"", ::to_lower(base_name));
   writer.write_line("#include \"lexer.hpp\"");
-  writer.write_line("#include <memory>");
-  writer.write_line("#include <any>");
+  writer.write_line("#include \"value.hpp\"");
+  writer.write_line("#include <utility>");
+  writer.new_line();
+  writer.write_line("static_assert({}_nodes_hash == {:#x}, \"{}.hpp is out of date, build the genast target\");",
+      ::to_lower(base_name), nodes_hash, ::to_lower(base_name));
   writer.new_line();
 
   // Forward declare bases classes
@@ -98,21 +155,10 @@ void generate_header(const std::string &output_dir, const std::string &base_name
   }
   writer.new_line();
 
-  // Define Visitor class
-  writer.write_line("struct {}Visitor", base_name);
-  writer.write_line("{{");
-  for (const auto&type : types)
-  {
-    auto class_name = trim(type.substr(0, type.find_first_of(':')));
-    writer.write_line("  virtual std::any visit_{}({} &expr) = 0;", ::to_lower(class_name), class_name);
-  }
-  writer.write_line("}};");
-  writer.new_line();
-
-  // Define the base class
+  // Define the base class, the kind tag replaces the vtable
   writer.write_line("struct {}", base_name);
   writer.write_line("{{");
-  writer.write_line("  virtual std::any accept({}Visitor &visitor) = 0;", base_name);
+  writer.write_line("  {}Kind kind;", base_name);
   writer.write_line("}};");
   writer.new_line();
 
@@ -122,33 +168,7 @@ void generate_header(const std::string &output_dir, const std::string &base_name
     auto class_name = trim(type.substr(0, type.find_first_of(':')));
     writer.write_line("struct {} : {}", class_name, base_name);
     writer.write_line("{{");
-    std::string_view sv(type);
-
-    // Find the first ':' and remove everything up to that point if it exists
-    auto colon_pos = sv.find_first_of(':');
-    if (colon_pos != std::string_view::npos) {
-      sv.remove_prefix(colon_pos + 1);
-    }
-
-    std::vector<std::string> fields;
-
-    // extract the name of derived classes
-    do {
-      // Find the next ',' or the end of the string view
-      auto comma_pos = sv.find_first_of(',');
-
-      // Extract and trim the substring up to the comma (or to the end if no comma found)
-      std::string current_type = trim(std::string(sv.substr(0, comma_pos)));
-      fields.emplace_back(current_type);
-
-      // Remove the processed part of the string view
-      if (comma_pos != std::string_view::npos) {
-        sv.remove_prefix(comma_pos + 1);
-      } else {
-        sv.remove_prefix(sv.size()); // Reached the end
-      }
-
-    } while (!sv.empty());
+    auto fields = split_fields(type);
 
     // define derived constructor
     writer.write("  explicit {} (", class_name);
@@ -158,7 +178,7 @@ void generate_header(const std::string &output_dir, const std::string &base_name
     }
     writer.write("{})", fields[fields.size() - 1]);
     writer.new_line();
-    writer.write("    : ");
+    writer.write("    : {}{{{}Kind::{}}}, ", base_name, base_name, class_name);
     for(int i{0}; i < fields.size() - 1; ++i)
     {
       auto pos = fields[i].find_last_of(' ');
@@ -173,13 +193,6 @@ void generate_header(const std::string &output_dir, const std::string &base_name
     writer.write_line("  }}");
     writer.new_line();
     
-    // define accept method
-    writer.write_line("  std::any accept({}Visitor &visitor) override", base_name);
-    writer.write_line("  {{");
-    writer.write_line("    return visitor.visit_{}(*this);", ::to_lower(class_name));
-    writer.write_line("  }}");
-    writer.new_line();
-
     // finally define fields
     for(const auto &field : fields)
     {
@@ -189,26 +202,449 @@ void generate_header(const std::string &output_dir, const std::string &base_name
     writer.write_line("}};");
     writer.new_line();
   }
+
+  // Define the visitor, dispatched on the kind tag with a typed result
+  writer.write_line("/*");
+  writer.write_line(" * CRTP visitor: Derived implements R visit_<node>(Node &expr) for every node");
+  writer.write_line(" */");
+  writer.write_line("template<typename Derived, typename R>");
+  writer.write_line("struct {}Visitor", base_name);
+  writer.write_line("{{");
+  writer.write_line("  R visit({} &expr)", base_name);
+  writer.write_line("  {{");
+  writer.write_line("    auto &self = static_cast<Derived &>(*this);");
+  writer.write_line("    switch (expr.kind)");
+  writer.write_line("    {{");
+  for (const auto &type : types)
+  {
+    auto class_name = class_name_of(type);
+    writer.write_line("      case {}Kind::{}: return self.visit_{}(static_cast<{} &>(expr));", base_name, class_name,
+        ::to_lower(class_name), class_name);
+  }
+  writer.write_line("    }}");
+  writer.write_line("    throw LoxException(\"Unknown {} kind\");", ::to_lower(base_name));
+  writer.write_line("  }}");
+  writer.write_line("}};");
+}
+
+/*
+ * Emits a flat layout of the same AST: every node of a batch lives in one
+ * contiguous vector as kind + token index + child indices, children are
+ * appended before their parents so a linear walk is a valid bottom up order.
+ * A node may have one Token and two other fields: child pointers, or values
+ * of any other type which are kept in a side vector per type.
+ */
+void generate_flat_header(const std::string &output_dir, const std::string &base_name,
+    const std::vector<std::string> &types, std::uint64_t nodes_hash)
+{
+  std::string file_name = std::format("{}/flat_{}.hpp", output_dir, ::to_lower(base_name));
+  FileWriter writer {file_name, std::ios::out};
+  std::string child_type = base_name + "*";
+  std::string flat_name = "Flat" + base_name;
+
+  writer.write_line("#pragma once");
+  writer.write_line("// Generated by generate_ast from {}_nodes.hpp, do not edit.", ::to_lower(base_name));
+  writer.new_line();
+  writer.write_line("#include \"arena.hpp\"");
+  writer.write_line("#include \"common.hpp\"");
+  writer.write_line("#include \"{}.hpp\"", ::to_lower(base_name));
+  writer.write_line("#include \"lexer.hpp\"");
+  writer.write_line("#include <cstdint>");
+  writer.write_line("#include <span>");
+  writer.write_line("#include <vector>");
+  writer.new_line();
+  writer.write_line("static_assert({}_nodes_hash == {:#x}, \"flat_{}.hpp is out of date, build the genast target\");",
+      ::to_lower(base_name), nodes_hash, ::to_lower(base_name));
+  writer.new_line();
+
+  writer.write_line("using {}Index = std::uint32_t;", base_name);
+  writer.new_line();
+
+  // Define the node record
+  writer.write_line("struct {}Node", flat_name);
+  writer.write_line("{{");
+  writer.write_line("  {}Kind kind;", base_name);
+  writer.write_line("  std::uint32_t token; // index into {}::tokens", flat_name);
+  writer.write_line("  {}Index children[2];", base_name);
+  writer.write_line("}};");
+  writer.new_line();
+
+  // Define a view per node type, the field order matches the linked nodes
+  for (const auto &type : types)
+  {
+    auto class_name = class_name_of(type);
+    writer.write_line("struct {}{}", "Flat", class_name);
+    writer.write_line("{{");
+    for (const auto &field : split_fields(type))
+    {
+      auto ftype = field_type(field);
+      if (ftype == child_type)
+      {
+        writer.write_line("  {}Index {};", base_name, field_name(field));
+      }
+      else
+      {
+        writer.write_line("  const {} &{};", ftype, field_name(field));
+      }
+    }
+    writer.write_line("}};");
+    writer.new_line();
+  }
+
+  // Define the container, over owned or borrowed arrays
+  writer.write_line("// A flat tree owns its arrays, or only looks at arrays stored elsewhere such as a mapped file");
+  writer.write_line("template<typename T> using OwnedArray = std::vector<T>;");
+  writer.write_line("template<typename T> using BorrowedArray = std::span<const T>;");
+  writer.new_line();
+  writer.write_line("template<template<typename> class Array>");
+  writer.write_line("struct Basic{}", flat_name);
+  writer.write_line("{{");
+  writer.write_line("  static constexpr std::uint32_t no_index = UINT32_MAX;");
+  writer.new_line();
+  writer.write_line("  Array<{}Node> nodes;", flat_name);
+  writer.write_line("  Array<Token> tokens;");
+  std::vector<std::string> side_types;
+  for (const auto &type : types)
+  {
+    for (const auto &field : split_fields(type))
+    {
+      auto ftype = field_type(field);
+      if (ftype != child_type && ftype != "Token" && std::ranges::find(side_types, ftype) == side_types.end())
+      {
+        side_types.push_back(ftype);
+        writer.write_line("  Array<{}> {}s;", ftype, ::to_lower(ftype));
+      }
+    }
+  }
+  writer.write_line("  Array<{}Index> roots; // top level expressions in insertion order", base_name);
+  writer.new_line();
+
+  for (const auto &type : types)
+  {
+    auto class_name = class_name_of(type);
+    auto lower_name = ::to_lower(class_name);
+    auto fields = split_fields(type);
+
+    // children take the first slots, side vector indices the remaining ones
+    std::vector<std::string> slots;
+    std::vector<std::size_t> slot_of(fields.size());
+    std::string token = "no_index";
+    for (std::size_t i{0}; i < fields.size(); ++i)
+    {
+      if (field_type(fields[i]) == child_type)
+      {
+        slot_of[i] = slots.size();
+        slots.push_back(field_name(fields[i]));
+      }
+    }
+    for (std::size_t i{0}; i < fields.size(); ++i)
+    {
+      auto ftype = field_type(fields[i]);
+      if (ftype == "Token")
+      {
+        if (token != "no_index")
+        {
+          throw LoxException(std::format("{} has more than one token", class_name));
+        }
+        token = "static_cast<std::uint32_t>(tokens.size() - 1)";
+      }
+      else if (ftype != child_type)
+      {
+        slot_of[i] = slots.size();
+        slots.push_back(std::format("static_cast<std::uint32_t>({}s.size() - 1)", ::to_lower(ftype)));
+      }
+    }
+    if (slots.size() > 2)
+    {
+      throw LoxException(std::format("{} has more than two children and values", class_name));
+    }
+    while (slots.size() < 2)
+    {
+      slots.emplace_back("no_index");
+    }
+
+    // append method
+    writer.write("  {}Index add_{}(", base_name, lower_name);
+    for (std::size_t i{0}; i < fields.size(); ++i)
+    {
+      auto ftype = field_type(fields[i]) == child_type ? base_name + "Index" : field_type(fields[i]);
+      writer.write("{}{} {}", i == 0 ? "" : ", ", ftype, field_name(fields[i]));
+    }
+    writer.write_line(")");
+    writer.write_line("  {{");
+    for (const auto &field : fields)
+    {
+      auto ftype = field_type(field);
+      if (ftype == "Token")
+      {
+        writer.write_line("    tokens.push_back({});", field_name(field));
+      }
+      else if (ftype != child_type)
+      {
+        writer.write_line("    {}s.push_back({});", ::to_lower(ftype), field_name(field));
+      }
+    }
+    writer.write_line("    nodes.push_back({}Node{{{}Kind::{}, {}, {{{}, {}}}}});", flat_name, base_name,
+        class_name, token, slots[0], slots[1]);
+    writer.write_line("    return static_cast<{}Index>(nodes.size() - 1);", base_name);
+    writer.write_line("  }}");
+    writer.new_line();
+
+    // accessor
+    writer.write_line("  [[nodiscard]] Flat{} {}({}Index index) const", class_name, lower_name, base_name);
+    writer.write_line("  {{");
+    writer.write_line("    const auto &node = nodes[index];");
+    writer.write("    return Flat{}{{", class_name);
+    for (std::size_t i{0}; i < fields.size(); ++i)
+    {
+      auto ftype = field_type(fields[i]);
+      if (ftype == child_type)
+      {
+        writer.write("{}node.children[{}]", i == 0 ? "" : ", ", slot_of[i]);
+      }
+      else if (ftype == "Token")
+      {
+        writer.write("{}tokens[node.token]", i == 0 ? "" : ", ");
+      }
+      else
+      {
+        writer.write("{}{}s[node.children[{}]]", i == 0 ? "" : ", ", ::to_lower(ftype), slot_of[i]);
+      }
+    }
+    writer.write_line("}};");
+    writer.write_line("  }}");
+    writer.new_line();
+  }
+
+  // traversal
+  writer.write_line("  // calls visitor.visit_<kind>(index, view) for the node at index");
+  writer.write_line("  template<typename Visitor>");
+  writer.write_line("  decltype(auto) visit({}Index index, Visitor &visitor) const", base_name);
+  writer.write_line("  {{");
+  writer.write_line("    switch (nodes[index].kind)");
+  writer.write_line("    {{");
+  for (const auto &type : types)
+  {
+    auto class_name = class_name_of(type);
+    auto lower_name = ::to_lower(class_name);
+    writer.write_line("      case {}Kind::{}: return visitor.visit_{}(index, {}(index));", base_name, class_name,
+        lower_name, lower_name);
+  }
+  writer.write_line("    }}");
+  writer.write_line("    throw LoxException(\"Unknown {} kind\");", ::to_lower(base_name));
+  writer.write_line("  }}");
+  writer.new_line();
+  writer.write_line("  [[nodiscard]] std::size_t size() const");
+  writer.write_line("  {{");
+  writer.write_line("    return nodes.size();");
+  writer.write_line("  }}");
+  writer.new_line();
+
+  // validation, for trees which come from outside the process
+  writer.write_line("  // throws LoxException unless every index is in range and every child precedes");
+  writer.write_line("  // its parent within the nodes of the same root");
+  writer.write_line("  void validate() const");
+  writer.write_line("  {{");
+  writer.write_line("    auto check = [](std::size_t index, std::size_t begin, std::size_t end) {{");
+  writer.write_line("      if (index < begin || index >= end)");
+  writer.write_line("      {{");
+  writer.write_line("        throw LoxException(\"{} index out of range\");", flat_name);
+  writer.write_line("      }}");
+  writer.write_line("    }};");
+  writer.write_line("    std::size_t first{{0}};");
+  writer.write_line("    for (auto root : roots)");
+  writer.write_line("    {{");
+  writer.write_line("      check(root, first, nodes.size());");
+  writer.write_line("      for (std::size_t index{{first}}; index <= root; ++index)");
+  writer.write_line("      {{");
+  writer.write_line("        const auto &node = nodes[index];");
+  writer.write_line("        switch (node.kind)");
+  writer.write_line("        {{");
+  for (const auto &type : types)
+  {
+    auto class_name = class_name_of(type);
+    auto fields = split_fields(type);
+    writer.write_line("          case {}Kind::{}:", base_name, class_name);
+    // the same slot assignment add_<node> uses: children first, then side vectors
+    std::size_t slot{0};
+    for (const auto &field : fields)
+    {
+      if (field_type(field) == child_type)
+      {
+        writer.write_line("            check(node.children[{}], first, index);", slot++);
+      }
+    }
+    for (const auto &field : fields)
+    {
+      auto ftype = field_type(field);
+      if (ftype == "Token")
+      {
+        writer.write_line("            check(node.token, 0, tokens.size());");
+      }
+      else if (ftype != child_type)
+      {
+        writer.write_line("            check(node.children[{}], 0, {}s.size());", slot++, ::to_lower(ftype));
+      }
+    }
+    writer.write_line("            break;");
+  }
+  writer.write_line("          default: throw LoxException(\"Unknown {} kind\");", ::to_lower(base_name));
+  writer.write_line("        }}");
+  writer.write_line("      }}");
+  writer.write_line("      first = std::size_t{{root}} + 1;");
+  writer.write_line("    }}");
+  writer.write_line("  }}");
+  writer.new_line();
+  writer.write_line("  // the same tree without ownership, valid while this one is left unchanged");
+  writer.write_line("  [[nodiscard]] Basic{}<BorrowedArray> view() const", flat_name);
+  writer.write_line("  {{");
+  std::string arrays = "nodes, tokens";
+  for (const auto &side : side_types)
+  {
+    arrays += ", " + ::to_lower(side) + "s";
+  }
+  writer.write_line("    return {{{}, roots}};", arrays);
+  writer.write_line("  }}");
+  writer.write_line("}};");
+  writer.new_line();
+  writer.write_line("using {} = Basic{}<OwnedArray>;", flat_name, flat_name);
+  writer.write_line("using {}View = Basic{}<BorrowedArray>;", flat_name, flat_name);
+  writer.new_line();
+
+  // Lowering from the pointer linked tree
+  writer.write_line("// Appends pointer linked {} trees to a {} in post order", base_name, flat_name);
+  writer.write_line("struct {}Builder : {}Visitor<{}Builder, {}Index>", flat_name, base_name, flat_name, base_name);
+  writer.write_line("{{");
+  writer.write_line("  explicit {}Builder({} &tree) : m_tree(tree)", flat_name, flat_name);
+  writer.write_line("  {{");
+  writer.write_line("  }}");
+  writer.new_line();
+  writer.write_line("  {}Index append({} &expr)", base_name, base_name);
+  writer.write_line("  {{");
+  writer.write_line("    auto root = visit(expr);");
+  writer.write_line("    m_tree.roots.push_back(root);");
+  writer.write_line("    return root;");
+  writer.write_line("  }}");
+  writer.new_line();
+  for (const auto &type : types)
+  {
+    auto class_name = class_name_of(type);
+    auto lower_name = ::to_lower(class_name);
+    auto fields = split_fields(type);
+    writer.write_line("  {}Index visit_{}({} &expr)", base_name, lower_name, class_name);
+    writer.write_line("  {{");
+    std::string args;
+    for (const auto &field : fields)
+    {
+      auto name = field_name(field);
+      if (field_type(field) == child_type)
+      {
+        writer.write_line("    auto {} = visit(*expr.{});", name, name);
+        args += (args.empty() ? "" : ", ") + name;
+      }
+      else
+      {
+        args += (args.empty() ? "expr." : ", expr.") + name;
+      }
+    }
+    writer.write_line("    return m_tree.add_{}({});", lower_name, args);
+    writer.write_line("  }}");
+  }
+  writer.new_line();
+  writer.write_line("private:");
+  writer.write_line("  {} &m_tree;", flat_name);
+  writer.write_line("}};");
+  writer.new_line();
+
+  // Rebuilding the pointer linked trees
+  writer.write_line("// Rebuilds the pointer linked trees of a {} one top level expression at a time.", flat_name);
+  writer.write_line("// Trees from outside the process must pass validate() first.");
+  writer.write_line("class {}Inflater", flat_name);
+  writer.write_line("{{");
+  writer.write_line("public:");
+  writer.write_line("  explicit {}Inflater({}View tree) : m_tree(tree)", flat_name, flat_name);
+  writer.write_line("  {{");
+  writer.write_line("  }}");
+  writer.new_line();
+  writer.write_line("  // tree of roots[root] allocated in arena, its nodes are the ones appended after the");
+  writer.write_line("  // previous root");
+  writer.write_line("  {} *inflate(std::size_t root, Arena &arena)", base_name);
+  writer.write_line("  {{");
+  writer.write_line("    m_first = root == 0 ? 0 : std::size_t{{m_tree.roots[root - 1]}} + 1;");
+  writer.write_line("    std::size_t last = m_tree.roots[root];");
+  writer.write_line("    m_built.resize(last - m_first + 1);");
+  writer.write_line("    for (std::size_t index{{m_first}}; index <= last; ++index)");
+  writer.write_line("    {{");
+  writer.write_line("      m_built[index - m_first] = build(static_cast<{}Index>(index), arena);", base_name);
+  writer.write_line("    }}");
+  writer.write_line("    return m_built.back();");
+  writer.write_line("  }}");
+  writer.new_line();
+  writer.write_line("private:");
+  writer.write_line("  {} *build({}Index index, Arena &arena)", base_name, base_name);
+  writer.write_line("  {{");
+  writer.write_line("    switch (m_tree.nodes[index].kind)");
+  writer.write_line("    {{");
+  for (const auto &type : types)
+  {
+    auto class_name = class_name_of(type);
+    auto lower_name = ::to_lower(class_name);
+    auto fields = split_fields(type);
+    writer.write_line("      case {}Kind::{}:", base_name, class_name);
+    writer.write_line("      {{");
+    writer.write_line("        auto view = m_tree.{}(index);", lower_name);
+    writer.write("        return arena.make<{}>(", class_name);
+    for (std::size_t i{0}; i < fields.size(); ++i)
+    {
+      auto name = field_name(fields[i]);
+      if (field_type(fields[i]) == child_type)
+      {
+        writer.write("{}m_built[view.{} - m_first]", i == 0 ? "" : ", ", name);
+      }
+      else
+      {
+        writer.write("{}view.{}", i == 0 ? "" : ", ", name);
+      }
+    }
+    writer.write_line(");");
+    writer.write_line("      }}");
+  }
+  writer.write_line("    }}");
+  writer.write_line("    throw LoxException(\"Unknown {} kind\");", ::to_lower(base_name));
+  writer.write_line("  }}");
+  writer.new_line();
+  writer.write_line("  {}View m_tree;", flat_name);
+  writer.write_line("  std::vector<{} *> m_built; // nodes of the current root, from its first node on", base_name);
+  writer.write_line("  std::size_t m_first{{0}};");
+  writer.write_line("}};");
 }
 
+// nodes_hash identifies the node list the headers are generated from
 void define_ast(const std::string &output_dir, const std::string &base_name,
-                const std::vector<std::string> &types)
+                const std::vector<std::string> &types, std::uint64_t nodes_hash, bool flat)
 {
-  generate_header(output_dir, base_name, types);
+  if (flat)
+  {
+    generate_flat_header(output_dir, base_name, types, nodes_hash);
+  }
+  else
+  {
+    generate_header(output_dir, base_name, types, nodes_hash);
+  }
 }
 
 int main(int argc, char *argv[]) {
-  if (argc != 2) {
-    std::cerr << "Usage: generate_ast <output_dir>\n";
+  bool flat = argc == 3 && std::string_view(argv[2]) == "--flat";
+  if (argc != 2 && !flat) {
+    std::cerr << "Usage: generate_ast <output_dir> [--flat]\n";
     return EX_USAGE;
   }
   std::string output_dir{argv[1]};
   try 
   {
-    define_ast(output_dir, "Expr",
-        {"Binary   : std::unique_ptr<Expr> left, Token op, std::unique_ptr<Expr> right",
-        "Grouping : std::unique_ptr<Expr> expression", "Literal  : Token value",
-        "Unary    : Token op, std::unique_ptr<Expr> right"});
+#define GenTypeStr(Name, Fields) #Name " :" Fields,
+#define GenFieldStr(Type, name) " " #Type " " #name ","
+    define_ast(output_dir, "Expr", {ExprFunc(GenTypeStr, GenFieldStr)}, expr_nodes_hash, flat);
   }
   catch (const LoxException &exception)
   {
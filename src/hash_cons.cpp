@@ -0,0 +1,81 @@
+#include "hash_cons.hpp"
+
+#include <functional>
+
+std::size_t HashCons::KeyHash::operator()(const Key &key) const
+{
+  auto mix = [](std::size_t seed, std::size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+  };
+  std::size_t hash = static_cast<std::size_t>(key.kind) << 8 | static_cast<std::size_t>(key.type);
+  hash = mix(hash, std::hash<const Expr *>{}(key.left));
+  hash = mix(hash, std::hash<const Expr *>{}(key.right));
+  return mix(hash, std::hash<std::string_view>{}(key.text));
+}
+
+Value::Type HashCons::type(const Expr *expr) const
+{
+  auto found = m_types.find(expr);
+  return found != m_types.end() ? found->second : Value::Type::Nil;
+}
+
+Expr* HashCons::literal(Arena &arena, const Token &value, Value constant, std::string_view text)
+{
+  return find_or_add(Key{ExprKind::Literal, value.type, nullptr, nullptr, text}, constant.type,
+                     [&] { return arena.make<Literal>(value, constant); });
+}
+
+Expr* HashCons::grouping(Arena &arena, Expr *expression)
+{
+  return find_or_add(Key{ExprKind::Grouping, TokenType::LEFT_PAREN, expression, nullptr, {}}, type(expression),
+                     [&] { return arena.make<Grouping>(expression); });
+}
+
+Expr* HashCons::unary(Arena &arena, const Token &op, Expr *right)
+{
+  auto build = [&] { return arena.make<Unary>(op, right); };
+  if (op.type == TokenType::BANG)
+  {
+    return find_or_add(Key{ExprKind::Unary, op.type, nullptr, right, {}}, Value::Type::Bool, build);
+  }
+  if (type(right) != Value::Type::Number)
+  {
+    return add_unshared(build);
+  }
+  return find_or_add(Key{ExprKind::Unary, op.type, nullptr, right, {}}, Value::Type::Number, build);
+}
+
+Expr* HashCons::binary(Arena &arena, Expr *left, const Token &op, Expr *right)
+{
+  auto build = [&] { return arena.make<Binary>(left, op, right); };
+  Value::Type left_type = type(left);
+  bool numbers = left_type == Value::Type::Number && type(right) == Value::Type::Number;
+  bool strings = left_type == Value::Type::String && type(right) == Value::Type::String;
+
+  // the checks the interpreter makes, on the types the operands evaluate to
+  Value::Type result;
+  switch (op.type)
+  {
+    case TokenType::EQAUL_EQUAL:
+    case TokenType::BANG_EQUAL: result = Value::Type::Bool; break;
+    case TokenType::PLUS:
+      if (!numbers && !strings) return add_unshared(build);
+      result = left_type;
+      break;
+    case TokenType::MINUS:
+    case TokenType::STAR:
+    case TokenType::SLASH:
+      if (!numbers) return add_unshared(build);
+      result = Value::Type::Number;
+      break;
+    case TokenType::GREATER:
+    case TokenType::GREATER_EQUAL:
+    case TokenType::LESS:
+    case TokenType::LESS_EQUAL:
+      if (!numbers) return add_unshared(build);
+      result = Value::Type::Bool;
+      break;
+    default: return add_unshared(build);
+  }
+  return find_or_add(Key{ExprKind::Binary, op.type, left, right, {}}, result, build);
+}
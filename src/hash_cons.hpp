@@ -0,0 +1,125 @@
+#pragma once
+
+#include "arena.hpp"
+#include "expr.hpp"
+#include "lexer.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+/*
+ * Structural hash table expression nodes are built through, so each shape is
+ * allocated only once: the same operator over the same children, or a
+ * literal with the same text. Children come from the table as well, so
+ * comparing them by address compares whole subtrees and the trees built
+ * through one table share their common parts as a DAG.
+ *
+ * A shared node keeps the tokens of its first occurrence, so only nodes
+ * which evaluate without a runtime error are shared. Operands are literals,
+ * so the type of every node is known while building it, and an operator
+ * applied to the wrong types gets a node of its own to report the error at
+ * its own token. Nodes live in the arena passed in,
+ * which must not be released while the table is in use, and literal text is
+ * looked at in place, so the source must outlive the table too.
+ */
+class HashCons
+{
+public:
+  Expr* literal(Arena &arena, const Token &value, Value constant, std::string_view text);
+  Expr* grouping(Arena &arena, Expr *expression);
+  Expr* unary(Arena &arena, const Token &op, Expr *right);
+  Expr* binary(Arena &arena, Expr *left, const Token &op, Expr *right);
+
+  // nodes asked for, including the ones handed out again
+  [[nodiscard]] std::size_t requested() const
+  {
+    return m_requested;
+  }
+
+  // nodes actually allocated
+  [[nodiscard]] std::size_t unique() const
+  {
+    return m_types.size();
+  }
+
+private:
+  struct Key
+  {
+    ExprKind kind;
+    TokenType type;        // operator, or type of the literal
+    const Expr *left;      // children, null where the node has fewer
+    const Expr *right;
+    std::string_view text; // lexeme of a literal
+
+    bool operator==(const Key &other) const = default;
+  };
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key &key) const;
+  };
+
+  // the node stored under key, made by build the first time key comes along.
+  // Evaluating it yields type.
+  template<typename Build>
+  Expr* find_or_add(const Key &key, Value::Type type, Build build)
+  {
+    ++m_requested;
+    auto [found, added] = m_nodes.try_emplace(key, nullptr);
+    if (added)
+    {
+      found->second = build();
+      m_types.emplace(found->second, type);
+    }
+    return found->second;
+  }
+
+  // a node nothing else points to, for an operator raising a runtime error
+  template<typename Build>
+  Expr* add_unshared(Build build)
+  {
+    ++m_requested;
+    Expr *node = build();
+    m_types.emplace(node, Value::Type::Nil);
+    return node;
+  }
+
+  [[nodiscard]] Value::Type type(const Expr *expr) const;
+
+  std::unordered_map<Key, Expr *, KeyHash> m_nodes;
+  // what every node handed out evaluates to, unimportant for the ones
+  // raising an error since their parents are never evaluated
+  std::unordered_map<const Expr *, Value::Type> m_types;
+  std::size_t m_requested{0};
+};
+
+/*
+ * Results of a visitor per node, for walking trees built through a HashCons
+ * where a node shared by many parents only needs to be worked on once.
+ * Results are keyed by node address and stay valid as long as the nodes do.
+ */
+template<typename R>
+class ExprMemo
+{
+public:
+  [[nodiscard]] const R* find(const Expr &expr) const
+  {
+    auto found = m_results.find(&expr);
+    return found != m_results.end() ? &found->second : nullptr;
+  }
+
+  void store(const Expr &expr, R result)
+  {
+    m_results.insert_or_assign(&expr, std::move(result));
+  }
+
+  void clear()
+  {
+    m_results.clear();
+  }
+
+private:
+  std::unordered_map<const Expr *, R> m_results;
+};
@@ -0,0 +1,105 @@
+#include "interpreter.hpp"
+
+#include <iostream>
+
+void Interpreter::interpret(Expr &expr, const SourceMap &source_map)
+{
+  try
+  {
+    Value value = evaluate(expr);
+    write_value(*Output::results->rdbuf(), value, m_strings);
+    Output::results->rdbuf()->sputc('\n');
+  }
+  catch (const RuntimeError &error)
+  {
+    runtime_error(source_map.position(error.token.offset), error.what());
+  }
+}
+
+void Interpreter::check_number_operand(const Token &op, const Value &operand)
+{
+  if (!operand.is_number())
+  {
+    throw RuntimeError(op, "Operand must be a number.");
+  }
+}
+
+void Interpreter::check_number_operands(const Token &op, const Value &left, const Value &right)
+{
+  if (!left.is_number() || !right.is_number())
+  {
+    throw RuntimeError(op, "Operands must be numbers.");
+  }
+}
+
+Value Interpreter::visit_binary(Binary &expr)
+{
+  Value left = visit(*expr.left);
+  Value right = visit(*expr.right);
+
+  switch (expr.op.type)
+  {
+    case TokenType::PLUS:
+      if (left.is_number() && right.is_number())
+      {
+        return Value::number(left.as.number + right.as.number);
+      }
+      if (left.is_string() && right.is_string())
+      {
+        m_concat.assign(m_strings.view(left.as.string));
+        m_concat.append(m_strings.view(right.as.string));
+        return Value::string(m_strings.intern(m_concat));
+      }
+      throw RuntimeError(expr.op, "Operands must be two numbers or two strings.");
+    case TokenType::MINUS:
+      check_number_operands(expr.op, left, right);
+      return Value::number(left.as.number - right.as.number);
+    case TokenType::STAR:
+      check_number_operands(expr.op, left, right);
+      return Value::number(left.as.number * right.as.number);
+    case TokenType::SLASH:
+      check_number_operands(expr.op, left, right);
+      return Value::number(left.as.number / right.as.number);
+    case TokenType::GREATER:
+      check_number_operands(expr.op, left, right);
+      return Value::boolean(left.as.number > right.as.number);
+    case TokenType::GREATER_EQUAL:
+      check_number_operands(expr.op, left, right);
+      return Value::boolean(left.as.number >= right.as.number);
+    case TokenType::LESS:
+      check_number_operands(expr.op, left, right);
+      return Value::boolean(left.as.number < right.as.number);
+    case TokenType::LESS_EQUAL:
+      check_number_operands(expr.op, left, right);
+      return Value::boolean(left.as.number <= right.as.number);
+    case TokenType::EQAUL_EQUAL: return Value::boolean(left == right);
+    case TokenType::BANG_EQUAL: return Value::boolean(!(left == right));
+    default: break;
+  }
+  throw RuntimeError(expr.op, "Unknown binary operator.");
+}
+
+Value Interpreter::visit_grouping(Grouping &expr)
+{
+  return visit(*expr.expression);
+}
+
+Value Interpreter::visit_literal(Literal &expr)
+{
+  return expr.constant;
+}
+
+Value Interpreter::visit_unary(Unary &expr)
+{
+  Value right = visit(*expr.right);
+
+  switch (expr.op.type)
+  {
+    case TokenType::MINUS:
+      check_number_operand(expr.op, right);
+      return Value::number(-right.as.number);
+    case TokenType::BANG: return Value::boolean(!right.is_truthy());
+    default: break;
+  }
+  throw RuntimeError(expr.op, "Unknown unary operator.");
+}
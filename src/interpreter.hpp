@@ -0,0 +1,78 @@
+#pragma once
+
+#include "common.hpp"
+#include "expr.hpp"
+#include "hash_cons.hpp"
+#include "lexer.hpp"
+#include "source_map.hpp"
+#include "value.hpp"
+#include <string>
+
+struct RuntimeError : LoxException
+{
+  RuntimeError(const Token &token, const std::string &what) : LoxException(what), token(token)
+  {
+  }
+
+  Token token;
+};
+
+/*
+ * Tree walking evaluator. Literals carry their decoded value, so evaluation
+ * never looks at token text; strings produced at runtime are interned into
+ * the same table the parser used.
+ */
+class Interpreter : public ExprVisitor<Interpreter, Value>
+{
+public:
+  explicit Interpreter(StringTable &strings) : m_strings(strings)
+  {
+  }
+
+  // evaluate expr, throws RuntimeError on type errors
+  Value evaluate(Expr &expr)
+  {
+    return visit(expr);
+  }
+
+  // remember the value of every operator node in memo and reuse it when the
+  // node comes along again, for trees sharing nodes. Expressions have no side
+  // effects, so a node always evaluates the same. nullptr stops memoizing.
+  void memoize(ExprMemo<Value> *memo)
+  {
+    m_memo = memo;
+  }
+
+  Value visit(Expr &expr)
+  {
+    if (m_memo == nullptr || expr.kind == ExprKind::Literal)
+    {
+      return ExprVisitor::visit(expr);
+    }
+    if (const Value *known = m_memo->find(expr))
+    {
+      return *known;
+    }
+    // a node which raises a runtime error is not stored and raises it again
+    Value value = ExprVisitor::visit(expr);
+    m_memo->store(expr, value);
+    return value;
+  }
+
+  // evaluate expr and print its value, runtime errors are reported at their
+  // position in source_map
+  void interpret(Expr &expr, const SourceMap &source_map);
+
+  Value visit_binary(Binary &expr);
+  Value visit_grouping(Grouping &expr);
+  Value visit_literal(Literal &expr);
+  Value visit_unary(Unary &expr);
+
+private:
+  static void check_number_operand(const Token &op, const Value &operand);
+  static void check_number_operands(const Token &op, const Value &left, const Value &right);
+
+  StringTable &m_strings;
+  std::string m_concat; // scratch buffer for string concatenation
+  ExprMemo<Value> *m_memo{nullptr};
+};
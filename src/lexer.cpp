@@ -1,5 +1,7 @@
 #include "common.hpp"
 #include <cctype>
+#include <charconv>
+#include <utility>
 #include "lexer.hpp"
 
 // return the TokenType as string
@@ -13,40 +15,47 @@ std::string to_string(TokenType type)
   }
 }
 
-std::string Token::to_string() const
+std::string Token::to_string(const TokenContext &tokens) const
 {
+  std::string lexeme{tokens.lexeme(*this)};
   std::string literal_text;
 
   switch (type) {
     case (TokenType::IDENTIFIER): literal_text = lexeme; break;
-    case (TokenType::STRING): literal_text = std::any_cast<std::string>(literal); break;
-    case (TokenType::NUMBER): literal_text = std::to_string(std::any_cast<double>(literal)); break;
+    case (TokenType::STRING): literal_text = tokens.string(*this); break;
+    case (TokenType::NUMBER): {
+      char digits[32];
+      auto [end, error] = std::to_chars(digits, digits + sizeof(digits), tokens.number(*this));
+      literal_text.assign(digits, end);
+    } break;
     case (TokenType::TRUE): literal_text = "true"; break;
     case (TokenType::FALSE): literal_text = "false"; break;
     default: literal_text = "nil"; break;
   }
-  return ::to_string(type) + " \"" + lexeme + "\" " + literal_text + " " +  std::to_string(line);
+  SourcePosition position = tokens.position(*this);
+  return ::to_string(type) + " \"" + lexeme + "\" " + literal_text + " " + std::to_string(position.line) + ":" +
+         std::to_string(position.column);
 }
 
-std::map<std::string, TokenType> Scanner::keywords
-{
-  {"and", TokenType::AND},
-  {"class", TokenType::CLASS},
-  {"else", TokenType::ELSE},
-  {"false", TokenType::FALSE},
-  {"for", TokenType::FOR},
-  {"fun", TokenType::FUN},
-  {"if", TokenType::IF},
-  {"nil", TokenType::NIL},
-  {"or", TokenType::OR},
-  {"print", TokenType::PRINT},
-  {"return", TokenType::RETURN},
-  {"super", TokenType::SUPER},
-  {"this", TokenType::THIS},
-  {"true", TokenType::TRUE},
-  {"var", TokenType::VAR},
-  {"while", TokenType::WHILE},
-};
+static_assert(keyword_type("and") == TokenType::AND);
+static_assert(keyword_type("class") == TokenType::CLASS);
+static_assert(keyword_type("else") == TokenType::ELSE);
+static_assert(keyword_type("false") == TokenType::FALSE);
+static_assert(keyword_type("for") == TokenType::FOR);
+static_assert(keyword_type("fun") == TokenType::FUN);
+static_assert(keyword_type("if") == TokenType::IF);
+static_assert(keyword_type("nil") == TokenType::NIL);
+static_assert(keyword_type("or") == TokenType::OR);
+static_assert(keyword_type("print") == TokenType::PRINT);
+static_assert(keyword_type("return") == TokenType::RETURN);
+static_assert(keyword_type("super") == TokenType::SUPER);
+static_assert(keyword_type("this") == TokenType::THIS);
+static_assert(keyword_type("true") == TokenType::TRUE);
+static_assert(keyword_type("var") == TokenType::VAR);
+static_assert(keyword_type("while") == TokenType::WHILE);
+static_assert(keyword_type("f") == TokenType::IDENTIFIER);
+static_assert(keyword_type("fork") == TokenType::IDENTIFIER);
+static_assert(keyword_type("thi") == TokenType::IDENTIFIER);
 
 bool Scanner::is_alpha(char c)
 {
@@ -58,11 +67,6 @@ bool Scanner::is_digit(char c)
   return std::isdigit(c);
 }
 
-bool Scanner::is_alnum(char c)
-{
-  return is_alpha(c) || is_digit(c);
-}
-
 bool Scanner::is_at_end()
 {
   return m_current >= m_source.size();
@@ -107,16 +111,30 @@ char Scanner::peek_next()
 
 void Scanner::add_token(TokenType type)
 {
-  add_token(type, m_source.substr(m_start, m_current - m_start), {});
+  add_token(type, m_start, m_current - m_start, Token::no_literal);
 }
 
-void Scanner::add_token(TokenType type, std::string lexeme, std::any literal)
+void Scanner::add_token(TokenType type, std::size_t offset, std::size_t length, std::uint32_t literal)
 {
-  m_tokens.emplace_back(type, std::move(lexeme), std::move(literal), m_line);
+  m_token.emplace(type, static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(length), literal);
 }
 
 
-std::vector<Token> Scanner::scan_tokens()
+TokenList Scanner::scan_tokens()
+{
+  TokenList list;
+  do
+  {
+    list.tokens.push_back(next());
+  } while (list.tokens.back().type != TokenType::eof);
+  list.source = m_source;
+  list.literals = std::move(m_context.literals);
+  list.strings = m_context.strings;
+  list.source_map = m_context.source_map;
+  return list;
+}
+
+Token Scanner::next()
 {
   while (!is_at_end())
   {
@@ -139,7 +157,8 @@ std::vector<Token> Scanner::scan_tokens()
       case '/': {
                   if (match('/'))
                   {
-                    while (peek() != '\n' && !is_at_end()) advance(); // we are inside a comment, consume until newline
+                    // we are inside a comment, consume until newline
+                    m_current = m_kernels.find_newline(m_source.data(), m_source.size(), m_current);
                   }
                   else
                   {
@@ -148,29 +167,26 @@ std::vector<Token> Scanner::scan_tokens()
                 } break;
       case '"': {
                   // we are inside a string, consume till we encounter the closing quote
-                  while (peek() != '"' && !is_at_end())
-                  {
-                    if (peek() == '\n')
-                    {
-                      ++m_line;
-                    }
-                    advance();
-                  }
+                  m_current = m_kernels.find_quote(m_source.data(), m_source.size(), m_current);
                   if (is_at_end())
                   {
-                    error(m_line, "Unterminated String");
+                    m_compilation.diagnostics().error(m_current, "Unterminated String");
                     continue;
                   }
                   // consume the closing quote
                   advance();
-                  auto lexeme_literal = m_source.substr(m_start + 1, m_current - m_start - 2);
-                  add_token(TokenType::STRING, lexeme_literal, lexeme_literal); // Exclude the quotes in lexeme
+                  // Exclude the quotes in lexeme
+                  std::size_t offset = m_start + 1;
+                  std::size_t length = m_current - m_start - 2;
+                  add_token(TokenType::STRING, offset, length, m_compilation.strings().intern(m_source.substr(offset, length)));
                 } break;
-      // Ignore whitespaces
+      // Ignore whitespaces, together with the rest of the run
+      case '\n':
       case ' ':
       case '\r':
-      case '\t': break;
-      case '\n': ++m_line; break;
+      case '\t':
+                m_current = m_kernels.skip_whitespace(m_source.data(), m_source.size(), m_current);
+                break;
       default : {
                   if (is_digit(c))
                   {
@@ -189,34 +205,36 @@ std::vector<Token> Scanner::scan_tokens()
                         advance();
                       }
                     }
-                    auto lexeme = m_source.substr(m_start, m_current - m_start);
-                    auto literal = std::stod(lexeme);
-                    add_token(TokenType::NUMBER, lexeme, literal);
+                    double literal{0};
+                    std::from_chars(m_source.data() + m_start, m_source.data() + m_current, literal);
+                    add_token(TokenType::NUMBER, m_start, m_current - m_start, m_context.literals.add_number(literal));
                   }
                   else if (is_alpha(c))
                   {
-                    while (is_alnum(peek()))
+                    m_current = m_kernels.skip_identifier(m_source.data(), m_source.size(), m_current);
+                    std::string_view text = m_source.substr(m_start, m_current - m_start);
+                    TokenType type = keyword_type(text);
+                    if (type == TokenType::IDENTIFIER)
                     {
-                      advance();
-                    }
-                    std::string str = m_source.substr(m_start, m_current - m_start);
-                    if (keywords.contains(str))
-                    {
-                      add_token(keywords[str]);
+                      add_token(type, m_start, m_current - m_start, m_compilation.strings().intern(text));
                     }
                     else
                     {
-                      add_token(TokenType::IDENTIFIER);
+                      add_token(type);
                     }
                   }
                   else
                   {
-                    error(m_line, "Unexpected character");
+                    m_compilation.diagnostics().error(m_start, "Unexpected character");
                   }
                 } break;
     }
     m_start = m_current;
+    if (m_token)
+    {
+      return *std::exchange(m_token, std::nullopt);
+    }
   }
   add_token(TokenType::eof);
-  return m_tokens;
+  return *std::exchange(m_token, std::nullopt);
 }
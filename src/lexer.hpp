@@ -1,10 +1,14 @@
 #pragma once
 
-#include <map>
+#include "compilation_context.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include "scan_kernels.hpp"
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
-#include <any>
 
 #define TokenFunc(Func) \
         Func(LEFT_PAREN) \
@@ -50,43 +54,270 @@
 #define GenEnum(E) E ,
 #define GenEnumStr(E) case TokenType::E: return #E; break; 
         
-enum class TokenType
+enum class TokenType : std::uint8_t
 {
   TokenFunc(GenEnum)
 };
 
 std::string to_string(TokenType type);
 
+// Classify an identifier as one of the reserved words or IDENTIFIER. Switches
+// on the first (and for f/t the second) character, so at most one string
+// compare is made per identifier.
+constexpr TokenType keyword_type(std::string_view text)
+{
+  auto rest = [text](std::size_t start, std::string_view tail, TokenType type) {
+    return text.substr(start) == tail ? type : TokenType::IDENTIFIER;
+  };
+
+  if (text.size() < 2)
+  {
+    return TokenType::IDENTIFIER;
+  }
+  switch (text[0])
+  {
+    case 'a': return rest(1, "nd", TokenType::AND);
+    case 'c': return rest(1, "lass", TokenType::CLASS);
+    case 'e': return rest(1, "lse", TokenType::ELSE);
+    case 'f':
+      switch (text[1])
+      {
+        case 'a': return rest(2, "lse", TokenType::FALSE);
+        case 'o': return rest(2, "r", TokenType::FOR);
+        case 'u': return rest(2, "n", TokenType::FUN);
+      }
+      break;
+    case 'i': return rest(1, "f", TokenType::IF);
+    case 'n': return rest(1, "il", TokenType::NIL);
+    case 'o': return rest(1, "r", TokenType::OR);
+    case 'p': return rest(1, "rint", TokenType::PRINT);
+    case 'r': return rest(1, "eturn", TokenType::RETURN);
+    case 's': return rest(1, "uper", TokenType::SUPER);
+    case 't':
+      switch (text[1])
+      {
+        case 'h': return rest(2, "is", TokenType::THIS);
+        case 'r': return rest(2, "ue", TokenType::TRUE);
+      }
+      break;
+    case 'v': return rest(1, "ar", TokenType::VAR);
+    case 'w': return rest(1, "hile", TokenType::WHILE);
+  }
+  return TokenType::IDENTIFIER;
+}
 
+struct TokenContext;
+
+/*
+ * A token does not own its text, it only records where the lexeme lives in the
+ * source buffer. The parsed value of a NUMBER token lives in the LiteralTable
+ * of the TokenContext the token belongs to, STRING and IDENTIFIER tokens carry
+ * the Symbol of their text instead. Lines and columns are looked up from the
+ * offset in the SourceMap of the context.
+ */
 struct Token {
+  // literal index of tokens which do not carry a value
+  static constexpr std::uint32_t no_literal = UINT32_MAX;
+  // literal index of tokens made up by the optimizer, their value is only
+  // known to the Literal node holding them
+  static constexpr std::uint32_t synthetic_literal = UINT32_MAX - 1;
+
   TokenType type;
-  std::string lexeme;
-  std::any literal;
-  int line;
+  std::uint32_t offset; // byte offset of the lexeme in the source
+  std::uint32_t length; // length of the lexeme in bytes
+  std::uint32_t literal;
+
+  Token(TokenType type, std::uint32_t offset, std::uint32_t length, std::uint32_t literal)
+      : type(type), offset(offset), length(length), literal(literal)
+  {
+  }
+
+  [[nodiscard]] std::string_view lexeme(std::string_view source) const
+  {
+    return source.substr(offset, length);
+  }
+
+  [[nodiscard]] bool is_synthetic() const
+  {
+    return literal == synthetic_literal;
+  }
+
+  [[nodiscard]] std::string to_string(const TokenContext &context) const;
+};
+
+/*
+ * Typed storage for the values of literal tokens, indexed by Token::literal.
+ * Indices keep counting up when old literals are discarded, so a streaming
+ * scanner only holds the literals of tokens that are still in use.
+ */
+struct LiteralTable
+{
+  std::vector<double> numbers;
+  std::uint32_t number_base{0}; // index of numbers[0]
+
+  std::uint32_t add_number(double value)
+  {
+    numbers.push_back(value);
+    return number_base + numbers.size() - 1;
+  }
+
+  [[nodiscard]] double number(std::uint32_t index) const
+  {
+    return numbers[index - number_base];
+  }
+
+  // drop the literals of every token scanned before token
+  void discard_before(const Token &token)
+  {
+    std::uint32_t numbers_end = token.type == TokenType::NUMBER ? token.literal : number_base + numbers.size();
+    numbers.erase(numbers.begin(), numbers.begin() + (numbers_end - number_base));
+    number_base = numbers_end;
+  }
+};
+
+/*
+ * The source and literal values tokens refer to
+ */
+struct TokenContext
+{
+  std::string_view source;
+  LiteralTable literals;
+  const StringTable *strings{nullptr}; // symbols of STRING and IDENTIFIER tokens
+  const SourceMap *source_map{nullptr}; // lines and columns of offsets into source
+
+  [[nodiscard]] std::string_view lexeme(const Token &token) const
+  {
+    return token.lexeme(source);
+  }
+
+  [[nodiscard]] double number(const Token &token) const
+  {
+    return literals.number(token.literal);
+  }
 
-  Token(TokenType type, std::string lexeme, std::any literal, int line)
-      : type(type), lexeme(std::move(lexeme)), literal(std::move(literal)), line(line) 
+  [[nodiscard]] std::string_view string(const Token &token) const
   {
+    return strings->view(token.literal);
   }
 
-  [[nodiscard]] std::string to_string() const;
+  [[nodiscard]] SourcePosition position(const Token &token) const
+  {
+    return source_map->position(token.offset);
+  }
 };
 
+/*
+ * Output of the scanner: all tokens together with their context
+ */
+struct TokenList : TokenContext
+{
+  std::vector<Token> tokens;
+};
 
 /*
- * Class to parse the given string and generate tokens from it
+ * Source of tokens the parser pulls from, one token at a time
  */
-struct Scanner
+struct TokenStream
+{
+  virtual ~TokenStream() = default;
+
+  // return the next token, once the input is exhausted every call returns eof
+  virtual Token next() = 0;
+
+  virtual const TokenContext& context() const = 0;
+
+  // everything before token has been consumed, state kept for it may go
+  virtual void release_before(const Token &)
+  {
+  }
+};
+
+/*
+ * Streams the tokens of an already scanned TokenList, or of the tokens in
+ * [begin, end) followed by an eof token where the next one starts
+ */
+struct TokenListStream : TokenStream
+{
+  explicit TokenListStream(const TokenList &tokens) : TokenListStream(tokens, 0, tokens.tokens.size())
+  {
+  }
+
+  TokenListStream(const TokenList &tokens, std::size_t begin, std::size_t end)
+    : m_tokens(tokens), m_next(begin), m_end(end),
+      m_eof{TokenType::eof, end < tokens.tokens.size() ? tokens.tokens[end].offset : 0, 0, Token::no_literal}
+  {
+  }
+
+  Token next() override
+  {
+    if (m_next == m_end)
+    {
+      return m_eof;
+    }
+    const Token &token = m_tokens.tokens[m_next];
+    // the eof of the list is handed out again and again
+    if (token.type != TokenType::eof)
+    {
+      ++m_next;
+    }
+    return token;
+  }
+
+  const TokenContext& context() const override
+  {
+    return m_tokens;
+  }
+
+private:
+  const TokenList &m_tokens;
+  std::size_t m_next;
+  std::size_t m_end;
+  Token m_eof; // handed out at the end of a range which stops short of the list's eof
+};
+
+/*
+ * Class to parse the given string and generate tokens from it. Tokens are
+ * either produced on demand through the TokenStream interface or all at once
+ * with scan_tokens.
+ */
+struct Scanner : TokenStream
 {
 
 public:
-  explicit Scanner(std::string source)
-    : m_source(std::move(source))
+  // The scanner does not copy the source, it must outlive the scanner and
+  // every TokenList produced from it. Errors go to the diagnostics of
+  // compilation, whose source map is pointed at source.
+  Scanner(std::string_view source, CompilationContext &compilation, const ScanKernels &kernels = ScanKernels::best())
+    : Scanner(source, compilation, 0, kernels)
   {
   }
 
-  // Generate tokens for given source string
-  std::vector<Token> scan_tokens();
+  // Scan source[begin, source.size()), begin must be the start of a lexeme.
+  // Token offsets stay relative to source.
+  Scanner(std::string_view source, CompilationContext &compilation, std::size_t begin,
+          const ScanKernels &kernels = ScanKernels::best())
+    : m_source(source), m_kernels(kernels), m_compilation(compilation),
+      m_context{source, {}, &compilation.strings(), &compilation.source_map()}, m_start(begin),
+      m_current(begin)
+  {
+    compilation.source_map().reset(source);
+  }
+
+  // Scan the next token
+  Token next() override;
+
+  const TokenContext& context() const override
+  {
+    return m_context;
+  }
+
+  void release_before(const Token &token) override
+  {
+    m_context.literals.discard_before(token);
+  }
+
+  // Scan every remaining token, the literal values move into the result
+  TokenList scan_tokens();
 
 private:
   bool is_at_end();
@@ -103,19 +334,19 @@ private:
   // return the next to next lexeme without consuming it
   char peek_next();
 
-  // add token to m_tokens
+  // set the token produced by the current lexeme
   void add_token(TokenType type);
-  void add_token(TokenType type, std::string lexeme, std::any literal);
+  // offset and length fit a Token, SourceBuffer caps sources at 4 GiB
+  void add_token(TokenType type, std::size_t offset, std::size_t length, std::uint32_t literal);
 
   bool is_alpha(char c);
   bool is_digit(char c);
-  bool is_alnum(char c);
-
-  std::string m_source;
-  std::vector<Token> m_tokens;
-  int m_start{0}; // start of current lexeme
-  int m_current{0};
-  int m_line{0};
 
-  static std::map<std::string, TokenType> keywords;
+  std::string_view m_source;
+  const ScanKernels &m_kernels;
+  CompilationContext &m_compilation;
+  TokenContext m_context;
+  std::optional<Token> m_token;
+  std::size_t m_start{0}; // start of current lexeme
+  std::size_t m_current{0};
 };
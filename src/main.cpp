@@ -1,85 +1,877 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <format>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
 
+#include "ast_cache.hpp"
+#include "chunk.hpp"
 #include "common.hpp"
+#include "compilation_context.hpp"
+#include "compiler.hpp"
+#include "flat_expr.hpp"
+#include "hash_cons.hpp"
+#include "interpreter.hpp"
 #include "lexer.hpp"
+#include "optimizer.hpp"
+#include "output_buffer.hpp"
+#include "parallel_lexer.hpp"
+#include "parallel_parser.hpp"
 #include "parser.hpp"
 #include "print.hpp"
+#include "session.hpp"
+#include "source.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include "value.hpp"
+#include "vm.hpp"
 
+// stdout of the main thread, the buffer is drained when the process exits
+OutputBuffer stdout_buffer{STDOUT_FILENO};
+std::ostream buffered_stdout{&stdout_buffer};
 
-void run(const std::string &source)
+struct Options
 {
-  Scanner scanner{source};
-  auto tokens = scanner.scan_tokens();
-  Parser parser {tokens};
+  bool parallel_scan{false};  // scan the whole script up front on all cores
+  bool parallel_parse{false}; // parse the top level expressions on all cores, without hash consing
+  bool eval{false};           // evaluate expressions instead of printing their tree
+  bool vm{false};             // evaluate expressions by compiling them to bytecode
+  bool optimize{false};       // run the optimizer passes before evaluating or printing
+  bool dump_optimized{false}; // print the optimized tree, even with --eval or --vm
+  bool stats{false};          // report time and allocations per phase as JSON lines
+  bool cache{false};          // reuse the trees of scripts parsed before, see AstCache
+  bool batch{false};          // run every script given, see runBatch
+  std::size_t jobs{0};        // worker threads of batch mode, 0 for one per hardware thread
+  std::size_t max_depth{Parser::default_max_depth}; // nesting the parser accepts
+  bool hash_cons{false};      // share identical subtrees between the trees of a script, see HashCons
+  bool stream{false};         // read the script in blocks to bound memory, see runStream
+};
+
+/*
+ * Hands every parsed expression to what the options ask for: the optimizer
+ * first, then the VM, the tree walker or the printer.
+ */
+class Backend
+{
+public:
+  Backend(const Options &options, StringTable &strings, Arena &arena, Stats *stats)
+    : m_options(options), m_interpreter{strings}, m_vm{strings}, m_passes(PassManager::standard()),
+      m_context{arena, strings, options.hash_cons}, m_stats(stats)
+  {
+  }
+
+  // reuse the values of nodes evaluated before, for trees sharing nodes
+  void memoize(ExprMemo<Value> *memo)
+  {
+    m_interpreter.memoize(memo);
+  }
+
+  void handle(Expr *expression, const TokenContext &tokens)
+  {
+    if (m_options.optimize)
+    {
+      Stats::Scope scope{m_stats, Stats::Phase::Optimize};
+      expression = m_passes.run(*expression, m_context);
+    }
+    if (m_options.vm && !m_options.dump_optimized)
+    {
+      Stats::Scope scope{m_stats, Stats::Phase::Eval};
+      m_compiler.compile(*expression, m_chunk);
+      m_vm.interpret(m_chunk, *tokens.source_map);
+    }
+    else if (m_options.eval && !m_options.dump_optimized)
+    {
+      Stats::Scope scope{m_stats, Stats::Phase::Eval};
+      m_interpreter.interpret(*expression, *tokens.source_map);
+    }
+    else
+    {
+      Stats::Scope scope{m_stats, Stats::Phase::Print};
+      AstPrinter printer{tokens};
+      printer.print(*expression, *Output::results);
+      Output::results->rdbuf()->sputc('\n');
+    }
+  }
+
+private:
+  const Options &m_options;
+  Interpreter m_interpreter;
+  Compiler m_compiler;
+  VM m_vm;
+  Chunk m_chunk;
+  PassManager m_passes;
+  OptimizerContext m_context;
+  Stats *m_stats;
+};
+
+// Report what parsing one expression found, then record its tree if record
+// is given and hand it to the backend. A null expression failed to parse,
+// its error is echoed to the results as well, after the report. Returns
+// whether the script goes on.
+bool handle_parsed(Expr *expression, CompilationContext &compilation, Backend &backend, const TokenContext &tokens,
+                   Stats *stats, FlatExpr *record)
+{
+  if (expression == nullptr)
+  {
+    std::string message = compilation.diagnostics().pending().back().message;
+    compilation.diagnostics().flush(*Output::diagnostics, compilation.source_map());
+    *Output::results << message << "\n";
+    return false;
+  }
+  compilation.diagnostics().flush(*Output::diagnostics, compilation.source_map());
+  if (compilation.diagnostics().had_error()) return false;
+  if (record != nullptr)
+  {
+    Stats::Scope scope{stats, Stats::Phase::Cache};
+    FlatExprBuilder{*record}.append(*expression);
+  }
+  backend.handle(expression, tokens);
+  return true;
+}
+
+// parse and handle every expression, their trees are appended to record if given
+void process(TokenStream &scanned, const Options &options, CompilationContext &compilation, Stats *stats,
+             FlatExpr *record)
+{
+  std::optional<StatsTokenStream> counted;
+  TokenStream &tokens = stats != nullptr ? counted.emplace(scanned, *stats) : scanned;
+
+  // shared nodes stay in the parser's arena until the script is done, and
+  // so do the values remembered for them
+  std::optional<HashCons> hash_cons;
+  ExprMemo<Value> memo;
+  std::size_t requested{0};
+  std::size_t unique{0};
+  if (options.hash_cons)
+  {
+    hash_cons.emplace();
+  }
+
+  std::optional<Parser> parsing;
+  {
+    Stats::Scope scope{stats, Stats::Phase::Parse};
+    parsing.emplace(tokens, compilation, options.max_depth, hash_cons ? &*hash_cons : nullptr);
+  }
+  Parser &parser = *parsing;
+  Backend backend{options, compilation.strings(), parser.arena(), stats};
+  if (hash_cons)
+  {
+    backend.memoize(&memo);
+  }
 
   while (!parser.is_at_end())
   {
-    auto expression = parser.parse();
+    Parser::ExprNode expression;
+    {
+      Stats::Scope scope{stats, Stats::Phase::Parse};
+      expression = parser.parse();
+    }
+    if (stats != nullptr && hash_cons)
+    {
+      // the arena keeps the earlier trees, count what this parse added
+      stats->add_nodes(hash_cons->unique() - unique);
+      stats->add_shared_nodes(hash_cons->requested() - requested, hash_cons->unique() - unique);
+      requested = hash_cons->requested();
+      unique = hash_cons->unique();
+    }
+    else if (stats != nullptr)
+    {
+      stats->add_nodes(parser.arena().allocation_count());
+    }
+
+    if (!handle_parsed(expression, compilation, backend, tokens.context(), stats, record)) return;
+    parser.release();
+  }
+}
+
+// like process, but the expressions are parsed on pool ahead of handling
+// them. Scanning is already done, so its errors are all known up front.
+void process_parallel(const TokenList &tokens, const Options &options, CompilationContext &compilation,
+                      ThreadPool &pool, Stats *stats, FlatExpr *record)
+{
+  std::optional<ParallelParser> parsing;
+  {
+    Stats::Scope scope{stats, Stats::Phase::Parse};
+    parsing.emplace(tokens, compilation.strings(), pool, options.max_depth);
+  }
+  ParallelParser &parser = *parsing;
+  if (stats != nullptr)
+  {
+    stats->add_tokens(tokens.tokens.size());
+  }
+  // the optimizer's nodes of each tree, the parsed ones are in the batches
+  Arena arena;
+  Backend backend{options, compilation.strings(), arena, stats};
+
+  while (!parser.done())
+  {
+    ParallelParser::Batch batch;
+    {
+      Stats::Scope scope{stats, Stats::Phase::Parse};
+      batch = parser.next();
+    }
+    if (stats != nullptr)
+    {
+      stats->add_nodes(batch.arena.allocation_count());
+    }
+
+    for (Expr *expression : batch.roots)
+    {
+      if (!handle_parsed(expression, compilation, backend, tokens, stats, record)) return;
+      arena.release();
+    }
+    if (batch.failed)
+    {
+      // the batch's error comes after the ones reported so far
+      compilation.diagnostics().append(std::move(batch.diagnostics));
+      handle_parsed(nullptr, compilation, backend, tokens, stats, record);
+      return;
+    }
+  }
+}
+
+// passes tokens through and remembers where the parser let go of them last,
+// everything before that offset belongs to expressions which are done
+class ReleaseTracker : public TokenStream
+{
+public:
+  explicit ReleaseTracker(TokenStream &tokens) : m_tokens(tokens)
+  {
+  }
+
+  Token next() override
+  {
+    return m_tokens.next();
+  }
+
+  const TokenContext& context() const override
+  {
+    return m_tokens.context();
+  }
+
+  void release_before(const Token &token) override
+  {
+    // the lexeme of a string leaves out the opening quote
+    m_released = token.type == TokenType::STRING ? token.offset - 1 : token.offset;
+    m_tokens.release_before(token);
+  }
+
+  [[nodiscard]] std::size_t released() const
+  {
+    return m_released;
+  }
+
+private:
+  TokenStream &m_tokens;
+  std::size_t m_released{0};
+};
+
+// like process, for the complete lines of a streamed script which start at
+// origin of the input. An expression is handled once the token after it is
+// seen, the one the lines end in may go on and is left for the next round
+// unless last is set. Returns how many bytes of lines are done with, or
+// nothing once an error stopped the script.
+std::optional<std::size_t> process_lines(std::string_view lines, SourcePosition origin, bool last,
+                                         const Options &options, Stats *stats)
+{
+  // symbols, literals and nodes only live for one round
+  StringTable strings;
+  CompilationContext compilation{strings};
+  Scanner scanner{lines, compilation};
+  compilation.source_map().reset(lines, origin);
+  ReleaseTracker tracker{scanner};
+  std::optional<StatsTokenStream> counted;
+  TokenStream &tokens = stats != nullptr ? counted.emplace(tracker, *stats) : static_cast<TokenStream &>(tracker);
+
+  Parser parser{tokens, compilation, options.max_depth};
+  Backend backend{options, strings, parser.arena(), stats};
+  // the parser ran into the end of the lines, or the scanner into a string
+  // going on after them, then only more input can tell what comes next
+  auto incomplete = [&lines, &compilation, last] {
+    const std::vector<Diagnostic> &pending = compilation.diagnostics().pending();
+    return !last && std::any_of(pending.begin(), pending.end(),
+                                [&lines](const Diagnostic &diagnostic) { return diagnostic.offset >= lines.size(); });
+  };
+
+  while (!parser.is_at_end())
+  {
+    Parser::ExprNode expression;
+    {
+      Stats::Scope scope{stats, Stats::Phase::Parse};
+      expression = parser.parse();
+    }
+    if (stats != nullptr)
+    {
+      stats->add_nodes(parser.arena().allocation_count());
+    }
+
+    // the error, or the expression, may go on in the lines still to come
+    if (expression == nullptr ? incomplete() : !last && parser.is_at_end())
+    {
+      return tracker.released();
+    }
+    if (!handle_parsed(expression, compilation, backend, tokens.context(), stats, nullptr)) return std::nullopt;
+    parser.release();
+  }
+
+  // only whitespace, comments or unscannable text are left
+  if (incomplete())
+  {
+    return tracker.released();
+  }
+  compilation.diagnostics().flush(*Output::diagnostics, compilation.source_map());
+  if (compilation.diagnostics().had_error()) return std::nullopt;
+  return lines.size();
+}
+
+// handle the expressions of a cached tree, scanning and parsing are skipped
+void process_cached(std::string_view source, const FlatExprView &tree, const Options &options, StringTable &strings,
+                    Stats *stats)
+{
+  SourceMap source_map{source};
+  TokenContext tokens{source, {}, &strings, &source_map};
+  Arena arena;
+  Backend backend{options, strings, arena, stats};
+  FlatExprInflater inflater{tree};
+  if (stats != nullptr)
+  {
+    stats->add_nodes(tree.size());
+    stats->add_tokens(tree.tokens.size());
+  }
+  for (std::size_t root{0}; root < tree.roots.size(); ++root)
+  {
+    Expr *expression;
+    {
+      Stats::Scope scope{stats, Stats::Phase::Cache};
+      expression = inflater.inflate(root, arena);
+    }
+    backend.handle(expression, tokens);
+    arena.release();
+  }
+}
+
+void run(std::string_view source, CompilationContext &compilation, const Options &options, Stats *stats)
+{
+  if (stats != nullptr)
+  {
+    stats->add_source_bytes(source.size());
+  }
+  StringTable &strings = compilation.strings();
+
+  std::optional<AstCache> cache;
+  if (options.cache)
+  {
+    std::optional<CachedTree> cached;
+    {
+      Stats::Scope scope{stats, Stats::Phase::Cache};
+      cache.emplace(AstCache::default_directory());
+      cached = cache->load(source, strings);
+    }
+    if (cached)
+    {
+      process_cached(source, cached->tree(), options, strings, stats);
+      return;
+    }
+  }
+  std::optional<FlatExpr> record;
+  if (cache)
+  {
+    record.emplace();
+  }
+
+  if (options.parallel_parse)
+  {
+    ThreadPool pool;
+    TokenList tokens;
+    {
+      Stats::Scope scope{stats, Stats::Phase::Scan};
+      tokens = options.parallel_scan ? scan_tokens_parallel(source, compilation, pool)
+                                     : Scanner{source, compilation}.scan_tokens();
+    }
+    process_parallel(tokens, options, compilation, pool, stats, record ? &*record : nullptr);
+  }
+  else if (options.parallel_scan)
+  {
+    ThreadPool pool;
+    TokenList tokens;
+    {
+      Stats::Scope scope{stats, Stats::Phase::Scan};
+      tokens = scan_tokens_parallel(source, compilation, pool);
+    }
+    TokenListStream stream{tokens};
+    process(stream, options, compilation, stats, record ? &*record : nullptr);
+  }
+  else
+  {
+    Scanner scanner{source, compilation};
+    process(scanner, options, compilation, stats, record ? &*record : nullptr);
+  }
+  compilation.diagnostics().flush(*Output::diagnostics, compilation.source_map());
+
+  // only trees of scripts which parsed cleanly are worth keeping
+  if (cache && !compilation.diagnostics().had_error())
+  {
+    Stats::Scope scope{stats, Stats::Phase::Cache};
+    cache->store(source, *record, strings);
+  }
+}
+
+// run one script, returns the status the process should exit with
+int runScript(const std::string &fileName, const Options &options)
+{
+  std::optional<Stats> stats;
+  if (options.stats)
+  {
+    stats.emplace();
+  }
+  Stats *recording = stats ? &*stats : nullptr;
+
+  SourceBuffer file;
+  try
+  {
+    Stats::Scope scope{recording, Stats::Phase::Read};
+    file = SourceBuffer::open(fileName);
+  }
+  catch (const SourceException &exception)
+  {
+    *Output::diagnostics << exception.what() << "\n";
+    return EX_NOINPUT;
+  }
+  StringTable strings;
+  CompilationContext compilation{strings};
+  run(file.view(), compilation, options, recording);
+  if (stats)
+  {
+    Output::results->flush();
+    stats->report(*Output::diagnostics);
+  }
+  if (compilation.diagnostics().had_error())
+  {
+    return EX_DATAERR;
+  }
+  if (Error::hadRuntimeError)
+  {
+    return EX_SOFTWARE;
+  }
+  return EXIT_SUCCESS;
+}
 
-    if (Error::hadError) return;
-    AstPrinter printer;
-    std::cout << printer.print(*expression) << "\n";
+/*
+ * Like runScript, but the script is read in blocks by a BlockReader and
+ * every round of complete lines goes through process_lines, so memory stays
+ * bounded by the block size and the longest expression however long the
+ * input is. Caching, hash consing and the parallel modes need all of the
+ * script at once and are not used.
+ */
+int runStream(const std::string &fileName, const Options &options)
+{
+  std::optional<Stats> stats;
+  if (options.stats)
+  {
+    stats.emplace();
+  }
+  Stats *recording = stats ? &*stats : nullptr;
+
+  int status = EXIT_SUCCESS;
+  try
+  {
+    BlockReader reader = BlockReader::open(fileName);
+    while (true)
+    {
+      {
+        Stats::Scope scope{recording, Stats::Phase::Read};
+        if (!reader.fill()) break;
+      }
+      std::optional<std::size_t> done = process_lines(reader.lines(), reader.origin(), reader.exhausted(), options,
+                                                      recording);
+      if (!done)
+      {
+        status = EX_DATAERR;
+        break;
+      }
+      if (recording != nullptr)
+      {
+        recording->add_source_bytes(*done);
+      }
+      reader.consume(*done);
+    }
   }
+  catch (const SourceException &exception)
+  {
+    *Output::diagnostics << exception.what() << "\n";
+    return EX_NOINPUT;
+  }
+  if (stats)
+  {
+    Output::results->flush();
+    stats->report(*Output::diagnostics);
+  }
+  if (status == EXIT_SUCCESS && Error::hadRuntimeError)
+  {
+    return EX_SOFTWARE;
+  }
+  return status;
 }
 
-void runFile(const std::string &fileName)
+void runFile(const std::string &fileName, const Options &options)
 {
-  std::ifstream fileHandle(fileName);
-  if (!fileHandle.is_open())
+  int status = options.stream ? runStream(fileName, options) : runScript(fileName, options);
+  if (status != EXIT_SUCCESS)
   {
-    std::cerr << std::format("Failed to open file {}\n", fileName);
+    std::exit(status);
+  }
+}
+
+// the paths listed in a manifest, one per line, relative ones are taken
+// relative to the manifest. Blank lines and lines starting with '#' are
+// skipped.
+std::vector<std::string> read_manifest(const std::string &fileName)
+{
+  std::ifstream manifest{fileName};
+  if (!manifest)
+  {
+    std::cerr << "Could not open manifest " << fileName << "\n";
     std::exit(EX_NOINPUT);
   }
-  std::stringstream ss;
-  ss << fileHandle.rdbuf();
-  std::string file = ss.str();
-  run(file);
-  if (Error::hadError)
+  std::filesystem::path base = std::filesystem::path(fileName).parent_path();
+  std::vector<std::string> scripts;
+  std::string line;
+  while (std::getline(manifest, line))
+  {
+    if (!line.empty() && line.back() == '\r')
+    {
+      line.pop_back();
+    }
+    if (line.empty() || line.front() == '#')
+    {
+      continue;
+    }
+    scripts.push_back((base / line).string());
+  }
+  return scripts;
+}
+
+/*
+ * Runs every script on a thread pool. What each script prints and reports is
+ * buffered and written out in the order the scripts were given, so the
+ * output does not depend on scheduling. The summary goes to stderr last.
+ */
+void runBatch(const std::vector<std::string> &scripts, const Options &options)
+{
+  struct Outcome
   {
-    std::exit(EX_DATAERR);
+    std::string results;
+    std::string diagnostics;
+    std::size_t bytes;
+    int status;
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  ThreadPool pool{options.jobs};
+  std::vector<std::future<Outcome>> outcomes;
+  outcomes.reserve(scripts.size());
+  for (const std::string &script : scripts)
+  {
+    outcomes.push_back(pool.submit([&script, &options] {
+      std::ostringstream results;
+      std::ostringstream diagnostics;
+      Output::results = &results;
+      Output::diagnostics = &diagnostics;
+      // the flag belongs to the worker thread, which ran other scripts before
+      Error::hadRuntimeError = false;
+      int status = runScript(script, options);
+      Output::results = &std::cout;
+      Output::diagnostics = &std::cerr;
+
+      std::error_code error;
+      std::size_t bytes = std::filesystem::file_size(script, error);
+      return Outcome{std::move(results).str(), std::move(diagnostics).str(), error ? 0 : bytes, status};
+    }));
+  }
+
+  // a missing script is worse than one which did not compile, which is
+  // worse than one failing at runtime
+  auto severity = [](int status) {
+    switch (status)
+    {
+      case EX_NOINPUT: return 3;
+      case EX_DATAERR: return 2;
+      case EX_SOFTWARE: return 1;
+      default: return 0;
+    }
+  };
+  int status = EXIT_SUCCESS;
+  std::size_t failed{0};
+  std::size_t bytes{0};
+  for (auto &future : outcomes)
+  {
+    Outcome outcome = future.get();
+    Output::results->write(outcome.results.data(), static_cast<std::streamsize>(outcome.results.size()));
+    std::cerr << outcome.diagnostics;
+    bytes += outcome.bytes;
+    if (outcome.status != EXIT_SUCCESS)
+    {
+      ++failed;
+    }
+    if (severity(outcome.status) > severity(status))
+    {
+      status = outcome.status;
+    }
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cerr << std::format("{} scripts ({} failed), {:.1f} MiB in {:.1f} ms on {} threads: {:.1f} MiB/s, {:.0f} scripts/s\n",
+                           scripts.size(), failed, bytes / (1024.0 * 1024.0), seconds * 1e3, pool.size(),
+                           bytes / (1024.0 * 1024.0) / seconds, scripts.size() / seconds);
+  if (status != EXIT_SUCCESS)
+  {
+    std::exit(status);
+  }
+}
+
+// decode the escapes of an :edit command's text, so it can hold newlines
+std::string unescape(std::string_view text)
+{
+  std::string decoded;
+  for (std::size_t i{0}; i < text.size(); ++i)
+  {
+    if (text[i] != '\\' || i + 1 == text.size())
+    {
+      decoded += text[i];
+      continue;
+    }
+    switch (text[++i])
+    {
+      case 'n': decoded += '\n'; break;
+      case 't': decoded += '\t'; break;
+      default: decoded += text[i]; break;
+    }
   }
+  return decoded;
 }
 
-void runPrompt()
+/*
+ * Every line typed is appended to one session buffer and only the
+ * expressions it completes or changes are handled. Besides plain lines the
+ * prompt understands
+ *   :edit OFFSET LENGTH TEXT  replace LENGTH bytes of the buffer at OFFSET
+ *   :reset                    start over with an empty buffer
+ */
+void runPrompt(Options options)
 {
+  // every line is a new script, caching them would only fill the disk
+  options.cache = false;
+  std::optional<Backend> backend;
+  Session session{[&backend](Expr &expression, const TokenContext &tokens) { backend->handle(&expression, tokens); }};
   std::string input;
   while (true)
   {
-    std::cout << "> ";
-    std::cin >> input;
-    if (!std::cin)
+    *Output::results << "> " << std::flush;
+    if (!std::getline(std::cin, input))
     {
-      if (std::cin.eof())
+      break;
+    }
+    std::optional<Stats> stats;
+    if (options.stats)
+    {
+      stats.emplace();
+    }
+    backend.emplace(options, session.strings(), session.arena(), stats ? &*stats : nullptr);
+    session.record(stats ? &*stats : nullptr);
+
+    std::string_view line{input};
+    try
+    {
+      if (line == ":reset")
       {
-        break;
+        session.reset();
+      }
+      else if (line.starts_with(":edit "))
+      {
+        std::istringstream command{std::string(line.substr(6))};
+        std::size_t offset;
+        std::size_t length;
+        if (!(command >> offset >> length))
+        {
+          std::cerr << "Usage: :edit OFFSET LENGTH TEXT\n";
+        }
+        else
+        {
+          command.get();
+          std::string text{std::istreambuf_iterator<char>(command), {}};
+          session.edit(offset, length, unescape(text));
+        }
+      }
+      else
+      {
+        session.append(input + "\n");
       }
-      std::cin.clear();
     }
-    run(input);
-    if (Error::hadError)
+    catch (const SessionException &exception)
     {
-      Error::hadError = false;
+      std::cerr << exception.what() << "\n";
     }
+
+    if (stats)
+    {
+      Output::results->flush();
+      stats->report(std::cerr);
+    }
+    Error::hadRuntimeError = false;
   }
 }
 
+void usage()
+{
+  std::cerr << "Usage: jlox [--parallel-scan] [--parallel-parse] [--eval] [--vm] [--optimize] [--dump-optimized]\n"
+            << "            [--stats] [--cache=on|off|clear] [--max-depth=N] [--hash-cons] [script]\n"
+            << "       jlox --stream [--eval] [--vm] [--optimize] [--stats] [--max-depth=N] [script|-]\n"
+            << "       jlox --batch [--jobs=N] [--manifest=file] [options] [script...]" << "\n"
+            << "            (--stream, --parallel-scan and --parallel-parse do not apply to --batch)\n";
+  std::exit(EX_USAGE);
+}
+
 int main(int argc, char **argv)
 {
-  if (argc > 2)
+  // results leave in large blocks, anything written to stderr drains them
+  // first so both streams still come out in order
+  Output::results = &buffered_stdout;
+  std::cerr.tie(&buffered_stdout);
+
+  Options options;
+  std::vector<std::string> scripts;
+  bool clear_cache{false};
+  for (int i{1}; i < argc; ++i)
+  {
+    std::string_view arg{argv[i]};
+    if (arg == "--parallel-scan")
+    {
+      options.parallel_scan = true;
+    }
+    else if (arg == "--parallel-parse")
+    {
+      options.parallel_parse = true;
+    }
+    else if (arg == "--eval")
+    {
+      options.eval = true;
+    }
+    else if (arg == "--vm")
+    {
+      options.vm = true;
+    }
+    else if (arg == "--optimize")
+    {
+      options.optimize = true;
+    }
+    else if (arg == "--stats")
+    {
+      options.stats = true;
+    }
+    else if (arg == "--hash-cons")
+    {
+      options.hash_cons = true;
+    }
+    else if (arg == "--stream")
+    {
+      options.stream = true;
+    }
+    else if (arg == "--cache=on" || arg == "--cache=off")
+    {
+      options.cache = arg == "--cache=on";
+    }
+    else if (arg == "--cache=clear")
+    {
+      clear_cache = true;
+    }
+    else if (arg == "--dump-optimized")
+    {
+      options.optimize = true;
+      options.dump_optimized = true;
+    }
+    else if (arg == "--batch")
+    {
+      options.batch = true;
+    }
+    else if (arg.starts_with("--jobs="))
+    {
+      auto count = arg.substr(7);
+      if (std::from_chars(count.data(), count.data() + count.size(), options.jobs).ec != std::errc{})
+      {
+        usage();
+      }
+    }
+    else if (arg.starts_with("--max-depth="))
+    {
+      auto depth = arg.substr(12);
+      if (std::from_chars(depth.data(), depth.data() + depth.size(), options.max_depth).ec != std::errc{} ||
+          options.max_depth < 1 || options.max_depth > Parser::max_supported_depth)
+      {
+        usage();
+      }
+    }
+    else if (arg.starts_with("--manifest="))
+    {
+      options.batch = true;
+      auto listed = read_manifest(std::string(arg.substr(11)));
+      scripts.insert(scripts.end(), listed.begin(), listed.end());
+    }
+    else if (arg.starts_with("--"))
+    {
+      usage();
+    }
+    else
+    {
+      scripts.emplace_back(arg);
+    }
+  }
+
+  if (clear_cache)
+  {
+    AstCache cache{AstCache::default_directory()};
+    std::cerr << "Removed " << cache.clear() << " entries from " << cache.directory().string() << "\n";
+    if (scripts.empty())
+    {
+      return EXIT_SUCCESS;
+    }
+  }
+
+  // batch workers read each script whole, and a pool of their own for
+  // every script would oversubscribe the cores the batch already uses
+  if (options.batch && (options.stream || options.parallel_scan || options.parallel_parse))
+  {
+    usage();
+  }
+
+  if (options.batch)
+  {
+    runBatch(scripts, options);
+  }
+  else if (scripts.size() > 1)
+  {
+    usage();
+  }
+  else if (!scripts.empty())
   {
-    std::cerr << "Usage: jlox [script]" << "\n";
-    std::exit(EX_USAGE);
+    runFile(scripts.front(), options);
   }
-  else if (argc == 2)
+  else if (options.stream)
   {
-    runFile(argv[1]);
+    runFile("-", options);
   }
   else
   {
-    runPrompt();
+    runPrompt(options);
   }
 
   return EXIT_SUCCESS;
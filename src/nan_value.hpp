@@ -0,0 +1,120 @@
+#pragma once
+
+#include "value.hpp"
+#include <bit>
+#include <cstdint>
+#include <string>
+
+/*
+ * 8 byte Value representation used by the VM. Doubles are stored as is, every
+ * other value is encoded in the payload of a quiet NaN: nil/false/true as small
+ * tags, strings as their Symbol with the sign bit set.
+ */
+class NanValue
+{
+public:
+  static NanValue nil()
+  {
+    return NanValue{quiet_nan | tag_nil};
+  }
+
+  static NanValue boolean(bool value)
+  {
+    return NanValue{quiet_nan | (value ? tag_true : tag_false)};
+  }
+
+  static NanValue number(double value)
+  {
+    return NanValue{std::bit_cast<std::uint64_t>(value)};
+  }
+
+  static NanValue string(Symbol value)
+  {
+    return NanValue{sign_bit | quiet_nan | value};
+  }
+
+  static NanValue from(const Value &value)
+  {
+    switch (value.type)
+    {
+      case Value::Type::Nil: return nil();
+      case Value::Type::Bool: return boolean(value.as.boolean);
+      case Value::Type::Number: return number(value.as.number);
+      case Value::Type::String: return string(value.as.string);
+    }
+    return nil();
+  }
+
+  [[nodiscard]] bool is_number() const
+  {
+    return (m_bits & quiet_nan) != quiet_nan;
+  }
+
+  [[nodiscard]] bool is_string() const
+  {
+    return (m_bits & (sign_bit | quiet_nan)) == (sign_bit | quiet_nan);
+  }
+
+  [[nodiscard]] bool is_bool() const
+  {
+    return (m_bits | 1) == (quiet_nan | tag_true);
+  }
+
+  [[nodiscard]] bool is_nil() const
+  {
+    return m_bits == (quiet_nan | tag_nil);
+  }
+
+  [[nodiscard]] double as_number() const
+  {
+    return std::bit_cast<double>(m_bits);
+  }
+
+  [[nodiscard]] bool as_bool() const
+  {
+    return m_bits == (quiet_nan | tag_true);
+  }
+
+  [[nodiscard]] Symbol as_string() const
+  {
+    return static_cast<Symbol>(m_bits);
+  }
+
+  // nil and false are falsey, everything else is truthy
+  [[nodiscard]] bool is_truthy() const
+  {
+    return !is_nil() && m_bits != (quiet_nan | tag_false);
+  }
+
+  [[nodiscard]] Value to_value() const
+  {
+    if (is_number()) return Value::number(as_number());
+    if (is_string()) return Value::string(as_string());
+    if (is_bool()) return Value::boolean(as_bool());
+    return Value::nil();
+  }
+
+  friend bool operator==(NanValue left, NanValue right)
+  {
+    if (left.is_number() && right.is_number())
+    {
+      return left.as_number() == right.as_number();
+    }
+    return left.m_bits == right.m_bits;
+  }
+
+private:
+  explicit NanValue(std::uint64_t bits) : m_bits(bits)
+  {
+  }
+
+  static constexpr std::uint64_t sign_bit = 0x8000000000000000;
+  static constexpr std::uint64_t quiet_nan = 0x7ffc000000000000;
+  static constexpr std::uint64_t tag_nil = 1;
+  static constexpr std::uint64_t tag_false = 2;
+  static constexpr std::uint64_t tag_true = 3;
+
+  std::uint64_t m_bits;
+};
+
+static_assert(sizeof(NanValue) == 8);
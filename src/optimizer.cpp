@@ -0,0 +1,253 @@
+#include "optimizer.hpp"
+
+#include <cmath>
+
+namespace
+{
+  // the literal expr stands for, looking through groupings
+  Literal* as_literal(Expr *expr)
+  {
+    while (expr->kind == ExprKind::Grouping)
+    {
+      expr = static_cast<Grouping *>(expr)->expression;
+    }
+    return expr->kind == ExprKind::Literal ? static_cast<Literal *>(expr) : nullptr;
+  }
+
+  // expr evaluates to a number whenever it evaluates at all
+  bool yields_number(const Expr &expr)
+  {
+    switch (expr.kind)
+    {
+      case ExprKind::Literal: return static_cast<const Literal &>(expr).constant.is_number();
+      case ExprKind::Grouping: return yields_number(*static_cast<const Grouping &>(expr).expression);
+      case ExprKind::Unary: return static_cast<const Unary &>(expr).op.type == TokenType::MINUS;
+      case ExprKind::Binary:
+      {
+        auto &binary = static_cast<const Binary &>(expr);
+        switch (binary.op.type)
+        {
+          case TokenType::MINUS:
+          case TokenType::STAR:
+          case TokenType::SLASH: return true;
+          case TokenType::PLUS: return yields_number(*binary.left) && yields_number(*binary.right);
+          default: return false;
+        }
+      }
+    }
+    return false;
+  }
+
+  // expr evaluates to true or false whenever it evaluates at all
+  bool yields_bool(const Expr &expr)
+  {
+    switch (expr.kind)
+    {
+      case ExprKind::Literal: return static_cast<const Literal &>(expr).constant.type == Value::Type::Bool;
+      case ExprKind::Grouping: return yields_bool(*static_cast<const Grouping &>(expr).expression);
+      case ExprKind::Unary: return static_cast<const Unary &>(expr).op.type == TokenType::BANG;
+      case ExprKind::Binary:
+      {
+        switch (static_cast<const Binary &>(expr).op.type)
+        {
+          case TokenType::GREATER:
+          case TokenType::GREATER_EQUAL:
+          case TokenType::LESS:
+          case TokenType::LESS_EQUAL:
+          case TokenType::EQAUL_EQUAL:
+          case TokenType::BANG_EQUAL: return true;
+          default: return false;
+        }
+      }
+    }
+    return false;
+  }
+
+  bool is_number_literal(Expr *expr, double value, bool negative)
+  {
+    Literal *literal = as_literal(expr);
+    return literal != nullptr && literal->constant.is_number() && literal->constant.as.number == value &&
+           std::signbit(literal->constant.as.number) == negative;
+  }
+
+  TokenType literal_type(const Value &value)
+  {
+    switch (value.type)
+    {
+      case Value::Type::Nil: return TokenType::NIL;
+      case Value::Type::Bool: return value.as.boolean ? TokenType::TRUE : TokenType::FALSE;
+      case Value::Type::Number: return TokenType::NUMBER;
+      case Value::Type::String: return TokenType::STRING;
+    }
+    return TokenType::NIL;
+  }
+}
+
+Expr* GroupingElimination::visit_grouping(Grouping &expr)
+{
+  return changed(visit(*expr.expression));
+}
+
+Expr* ConstantFolding::fold(const Token &origin, Value value)
+{
+  Token token{literal_type(value), origin.offset, origin.length, Token::synthetic_literal};
+  return changed(context().arena.make<Literal>(token, value));
+}
+
+Expr* ConstantFolding::visit_binary(Binary &node)
+{
+  Binary &expr = rewrite_children(node);
+
+  Literal *left_literal = as_literal(expr.left);
+  Literal *right_literal = as_literal(expr.right);
+  if (left_literal == nullptr || right_literal == nullptr)
+  {
+    return &expr;
+  }
+  const Value &left = left_literal->constant;
+  const Value &right = right_literal->constant;
+
+  switch (expr.op.type)
+  {
+    case TokenType::EQAUL_EQUAL: return fold(expr.op, Value::boolean(left == right));
+    case TokenType::BANG_EQUAL: return fold(expr.op, Value::boolean(!(left == right)));
+    case TokenType::PLUS:
+      if (left.is_string() && right.is_string())
+      {
+        m_concat.assign(context().strings.view(left.as.string));
+        m_concat.append(context().strings.view(right.as.string));
+        return fold(expr.op, Value::string(context().strings.intern(m_concat)));
+      }
+      break;
+    default: break;
+  }
+
+  if (!left.is_number() || !right.is_number())
+  {
+    return &expr;
+  }
+  double a = left.as.number;
+  double b = right.as.number;
+  switch (expr.op.type)
+  {
+    case TokenType::PLUS: return fold(expr.op, Value::number(a + b));
+    case TokenType::MINUS: return fold(expr.op, Value::number(a - b));
+    case TokenType::STAR: return fold(expr.op, Value::number(a * b));
+    case TokenType::SLASH: return fold(expr.op, Value::number(a / b));
+    case TokenType::GREATER: return fold(expr.op, Value::boolean(a > b));
+    case TokenType::GREATER_EQUAL: return fold(expr.op, Value::boolean(a >= b));
+    case TokenType::LESS: return fold(expr.op, Value::boolean(a < b));
+    case TokenType::LESS_EQUAL: return fold(expr.op, Value::boolean(a <= b));
+    default: return &expr;
+  }
+}
+
+Expr* ConstantFolding::visit_unary(Unary &node)
+{
+  Unary &expr = rewrite_children(node);
+
+  Literal *operand = as_literal(expr.right);
+  if (operand == nullptr)
+  {
+    return &expr;
+  }
+  switch (expr.op.type)
+  {
+    case TokenType::BANG: return fold(expr.op, Value::boolean(!operand->constant.is_truthy()));
+    case TokenType::MINUS:
+      if (operand->constant.is_number())
+      {
+        return fold(expr.op, Value::number(-operand->constant.as.number));
+      }
+      return &expr;
+    default: return &expr;
+  }
+}
+
+Expr* NegationElimination::visit_unary(Unary &node)
+{
+  Unary &expr = rewrite_children(node);
+
+  Expr *inner = expr.right;
+  while (inner->kind == ExprKind::Grouping)
+  {
+    inner = static_cast<Grouping *>(inner)->expression;
+  }
+  if (inner->kind != ExprKind::Unary)
+  {
+    return &expr;
+  }
+  auto &operand = static_cast<Unary &>(*inner);
+  if (operand.op.type != expr.op.type)
+  {
+    return &expr;
+  }
+  // -(-x) is x for every double, !!x is only x when x is already a boolean
+  if (expr.op.type == TokenType::MINUS && yields_number(*operand.right))
+  {
+    return changed(operand.right);
+  }
+  if (expr.op.type == TokenType::BANG && yields_bool(*operand.right))
+  {
+    return changed(operand.right);
+  }
+  return &expr;
+}
+
+Expr* AlgebraicSimplification::visit_binary(Binary &node)
+{
+  Binary &expr = rewrite_children(node);
+
+  // the operand which is kept must be a number, or the operator would have
+  // raised a runtime error that the simplified tree no longer does
+  switch (expr.op.type)
+  {
+    case TokenType::STAR:
+      if (is_number_literal(expr.right, 1, false) && yields_number(*expr.left)) return changed(expr.left);
+      if (is_number_literal(expr.left, 1, false) && yields_number(*expr.right)) return changed(expr.right);
+      break;
+    case TokenType::SLASH:
+      if (is_number_literal(expr.right, 1, false) && yields_number(*expr.left)) return changed(expr.left);
+      break;
+    case TokenType::MINUS:
+      // -0 - 0 is -0, but -0 - -0 is 0
+      if (is_number_literal(expr.right, 0, false) && yields_number(*expr.left)) return changed(expr.left);
+      break;
+    case TokenType::PLUS:
+      // -0 + 0 is 0, so only adding -0 leaves every number as it was
+      if (is_number_literal(expr.right, 0, true) && yields_number(*expr.left)) return changed(expr.left);
+      if (is_number_literal(expr.left, 0, true) && yields_number(*expr.right)) return changed(expr.right);
+      break;
+    default: break;
+  }
+  return &expr;
+}
+
+PassManager PassManager::standard()
+{
+  PassManager passes;
+  passes.add<GroupingElimination>();
+  passes.add<ConstantFolding>();
+  passes.add<NegationElimination>();
+  passes.add<AlgebraicSimplification>();
+  return passes;
+}
+
+Expr* PassManager::run(Expr &expr, OptimizerContext &context)
+{
+  Expr *root = &expr;
+  for (int round{0}; round < max_rounds; ++round)
+  {
+    std::size_t changes{0};
+    for (auto &pass : m_passes)
+    {
+      root = pass->run(*root, context, changes);
+    }
+    m_changes += changes;
+    if (changes == 0)
+    {
+      break;
+    }
+  }
+  return root;
+}
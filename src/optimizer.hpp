@@ -0,0 +1,244 @@
+#pragma once
+
+#include "arena.hpp"
+#include "expr.hpp"
+#include "lexer.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+ * What the passes need to build replacement nodes: new nodes go into the
+ * arena the tree lives in, strings made by folding are interned next to the
+ * parsed ones. A shared tree has nodes other trees point to as well, see
+ * HashCons, so a node whose children change is copied instead.
+ */
+struct OptimizerContext
+{
+  Arena &arena;
+  StringTable &strings;
+  bool shared{false};
+};
+
+/*
+ * A rewrite over one expression tree. Passes may change nodes in place,
+ * unless the context says the tree is shared, or return a different root;
+ * they never change what the expression evaluates to, including which
+ * runtime error it raises.
+ */
+class Pass
+{
+public:
+  virtual ~Pass() = default;
+
+  [[nodiscard]] virtual std::string_view name() const = 0;
+
+  // rewrite expr and return the new root, count every rewrite in changes
+  virtual Expr* run(Expr &expr, OptimizerContext &context, std::size_t &changes) = 0;
+};
+
+/*
+ * Default walk for passes: every child is visited and replaced by whatever the
+ * visit returns. Derived passes override visit_<node> for the nodes they
+ * rewrite and call rewrite_children to handle the children, going on with
+ * the node it returns.
+ */
+template<typename Derived>
+class RewritePass : public Pass, public ExprVisitor<Derived, Expr*>
+{
+public:
+  Expr* run(Expr &expr, OptimizerContext &context, std::size_t &changes) override
+  {
+    m_context = &context;
+    m_changes = &changes;
+    return this->visit(expr);
+  }
+
+  Expr* visit_binary(Binary &expr)
+  {
+    return &rewrite_children(expr);
+  }
+
+  Expr* visit_grouping(Grouping &expr)
+  {
+    return &rewrite_children(expr);
+  }
+
+  Expr* visit_literal(Literal &expr)
+  {
+    return &expr;
+  }
+
+  Expr* visit_unary(Unary &expr)
+  {
+    return &rewrite_children(expr);
+  }
+
+protected:
+  // expr with its children replaced by their visits, a copy of expr if a
+  // child changed and the tree is shared
+  Binary& rewrite_children(Binary &expr)
+  {
+    Expr *left = this->visit(*expr.left);
+    Expr *right = this->visit(*expr.right);
+    if (left == expr.left && right == expr.right)
+    {
+      return expr;
+    }
+    if (m_context->shared)
+    {
+      return *m_context->arena.make<Binary>(left, expr.op, right);
+    }
+    expr.left = left;
+    expr.right = right;
+    return expr;
+  }
+
+  Grouping& rewrite_children(Grouping &expr)
+  {
+    Expr *expression = this->visit(*expr.expression);
+    if (expression == expr.expression)
+    {
+      return expr;
+    }
+    if (m_context->shared)
+    {
+      return *m_context->arena.make<Grouping>(expression);
+    }
+    expr.expression = expression;
+    return expr;
+  }
+
+  Unary& rewrite_children(Unary &expr)
+  {
+    Expr *right = this->visit(*expr.right);
+    if (right == expr.right)
+    {
+      return expr;
+    }
+    if (m_context->shared)
+    {
+      return *m_context->arena.make<Unary>(expr.op, right);
+    }
+    expr.right = right;
+    return expr;
+  }
+
+  Expr* changed(Expr *replacement)
+  {
+    ++*m_changes;
+    return replacement;
+  }
+
+  OptimizerContext &context()
+  {
+    return *m_context;
+  }
+
+private:
+  OptimizerContext *m_context{nullptr};
+  std::size_t *m_changes{nullptr};
+};
+
+// (group x) -> x, the tree already encodes the precedence
+class GroupingElimination : public RewritePass<GroupingElimination>
+{
+public:
+  [[nodiscard]] std::string_view name() const override
+  {
+    return "grouping-elimination";
+  }
+
+  using RewritePass::visit_binary;
+  using RewritePass::visit_literal;
+  using RewritePass::visit_unary;
+  Expr* visit_grouping(Grouping &expr);
+};
+
+// operators whose operands are all literals are replaced by their value,
+// operations which would fail at runtime are left for the runtime to report
+class ConstantFolding : public RewritePass<ConstantFolding>
+{
+public:
+  [[nodiscard]] std::string_view name() const override
+  {
+    return "constant-folding";
+  }
+
+  using RewritePass::visit_grouping;
+  using RewritePass::visit_literal;
+  Expr* visit_binary(Binary &expr);
+  Expr* visit_unary(Unary &expr);
+
+private:
+  Expr* fold(const Token &origin, Value value);
+  std::string m_concat; // scratch buffer for string concatenation
+};
+
+// -(-x) -> x for numbers and !!x -> x for booleans
+class NegationElimination : public RewritePass<NegationElimination>
+{
+public:
+  [[nodiscard]] std::string_view name() const override
+  {
+    return "negation-elimination";
+  }
+
+  using RewritePass::visit_binary;
+  using RewritePass::visit_grouping;
+  using RewritePass::visit_literal;
+  Expr* visit_unary(Unary &expr);
+};
+
+// identities which hold for every double, including -0, infinities and NaN:
+// x * 1, 1 * x, x / 1, x - 0, x + -0 and -0 + x are all x
+class AlgebraicSimplification : public RewritePass<AlgebraicSimplification>
+{
+public:
+  [[nodiscard]] std::string_view name() const override
+  {
+    return "algebraic-simplification";
+  }
+
+  using RewritePass::visit_grouping;
+  using RewritePass::visit_literal;
+  using RewritePass::visit_unary;
+  Expr* visit_binary(Binary &expr);
+};
+
+/*
+ * Runs its passes in the order they were added, over and over until a
+ * round changes nothing or max_rounds is reached.
+ */
+class PassManager
+{
+public:
+  static constexpr int max_rounds = 8;
+
+  // the passes Optimize turns on: groupings, folding, negations, identities
+  static PassManager standard();
+
+  template<typename T, typename... Args>
+  T& add(Args&&... args)
+  {
+    auto pass = std::make_unique<T>(std::forward<Args>(args)...);
+    T &result = *pass;
+    m_passes.push_back(std::move(pass));
+    return result;
+  }
+
+  Expr* run(Expr &expr, OptimizerContext &context);
+
+  // rewrites done by all passes since the manager was created
+  [[nodiscard]] std::size_t changes() const
+  {
+    return m_changes;
+  }
+
+private:
+  std::vector<std::unique_ptr<Pass>> m_passes;
+  std::size_t m_changes{0};
+};
@@ -0,0 +1,77 @@
+#include "output_buffer.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+OutputBuffer::OutputBuffer(int fd, std::size_t block_size) : m_fd(fd), m_block(block_size)
+{
+  setp(m_block.data(), m_block.data() + m_block.size());
+}
+
+OutputBuffer::~OutputBuffer()
+{
+  drain();
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type c)
+{
+  if (!drain())
+  {
+    return traits_type::eof();
+  }
+  if (!traits_type::eq_int_type(c, traits_type::eof()))
+  {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+std::streamsize OutputBuffer::xsputn(const char *data, std::streamsize count)
+{
+  auto size = static_cast<std::size_t>(count);
+  if (size > static_cast<std::size_t>(epptr() - pptr()))
+  {
+    if (!drain())
+    {
+      return 0;
+    }
+    // too big to be worth copying, hand it over as it is
+    if (size >= m_block.size())
+    {
+      return write_all(data, size) ? count : 0;
+    }
+  }
+  std::memcpy(pptr(), data, size);
+  pbump(static_cast<int>(size));
+  return count;
+}
+
+int OutputBuffer::sync()
+{
+  return drain() ? 0 : -1;
+}
+
+bool OutputBuffer::drain()
+{
+  bool written = write_all(pbase(), pptr() - pbase());
+  setp(m_block.data(), m_block.data() + m_block.size());
+  return written;
+}
+
+bool OutputBuffer::write_all(const char *data, std::size_t count)
+{
+  while (count > 0)
+  {
+    ssize_t written = ::write(m_fd, data, count);
+    if (written < 0)
+    {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += written;
+    count -= written;
+  }
+  return true;
+}
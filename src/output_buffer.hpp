@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <streambuf>
+#include <vector>
+
+/*
+ * Stream buffer collecting output in one large block which is handed to a
+ * file descriptor with a single write(2) once it fills up, on flush and when
+ * the buffer goes away. Nothing goes through stdio, so there is no per
+ * character synchronisation with C streams.
+ */
+class OutputBuffer : public std::streambuf
+{
+public:
+  static constexpr std::size_t default_block_size = 64 * 1024;
+
+  // the descriptor is not closed by the buffer
+  explicit OutputBuffer(int fd, std::size_t block_size = default_block_size);
+  ~OutputBuffer() override;
+
+  OutputBuffer(const OutputBuffer &) = delete;
+  OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+protected:
+  int_type overflow(int_type c) override;
+  std::streamsize xsputn(const char *data, std::streamsize count) override;
+  int sync() override;
+
+private:
+  // write everything buffered, false if the descriptor failed
+  bool drain();
+  bool write_all(const char *data, std::size_t count);
+
+  int m_fd;
+  std::vector<char> m_block;
+};
@@ -0,0 +1,168 @@
+#include "parallel_lexer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace
+{
+  // Whether a line start lies inside a string literal. Comments always end
+  // at a newline so they never span a line start.
+  enum class LineState : unsigned char
+  {
+    Code,
+    String,
+  };
+
+  struct ChunkSummary
+  {
+    // state at the end of the chunk for each possible state at its start
+    LineState end[2];
+  };
+
+  // Track string and comment state the same way Scanner does: a quote at the
+  // start of a lexeme opens a string, "//" outside a string opens a comment
+  LineState run_states(std::string_view text, LineState state)
+  {
+    bool in_string = state == LineState::String;
+    const char *pos = text.data();
+    const char *end = pos + text.size();
+    while (pos < end)
+    {
+      if (in_string)
+      {
+        pos = static_cast<const char *>(std::memchr(pos, '"', end - pos));
+        if (pos == nullptr) break;
+        in_string = false;
+        ++pos;
+        continue;
+      }
+      char c = *pos++;
+      if (c == '"')
+      {
+        in_string = true;
+      }
+      else if (c == '/' && pos < end && *pos == '/')
+      {
+        pos = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+        if (pos == nullptr) break;
+      }
+    }
+    return in_string ? LineState::String : LineState::Code;
+  }
+
+  // position after the first newline at or after pos, or size
+  std::size_t next_line_start(std::string_view source, std::size_t pos)
+  {
+    auto newline = source.find('\n', pos);
+    return newline == std::string_view::npos ? source.size() : newline + 1;
+  }
+
+  struct Segment
+  {
+    std::size_t begin;
+    std::size_t end;
+  };
+
+  struct SegmentResult
+  {
+    StringTable strings;
+    TokenList tokens;
+    Diagnostics diagnostics;
+  };
+}
+
+TokenList scan_tokens_parallel(std::string_view source, CompilationContext &compilation, ThreadPool &pool,
+                               std::size_t min_chunk_size)
+{
+  std::size_t chunk_count = std::min(pool.size() * 4, source.size() / std::max<std::size_t>(min_chunk_size, 1));
+  if (chunk_count < 2)
+  {
+    Scanner scanner{source, compilation};
+    return scanner.scan_tokens();
+  }
+
+  // candidate cut points are line starts near evenly spaced offsets
+  std::vector<std::size_t> cuts{0};
+  for (std::size_t i{1}; i < chunk_count; ++i)
+  {
+    std::size_t cut = next_line_start(source, source.size() / chunk_count * i);
+    if (cut > cuts.back() && cut < source.size())
+    {
+      cuts.push_back(cut);
+    }
+  }
+  cuts.push_back(source.size());
+
+  // pre-pass: summarise every chunk for both possible start states
+  std::vector<ChunkSummary> summaries(cuts.size() - 1);
+  pool.parallel_for(summaries.size(), [&](std::size_t i) {
+    auto text = source.substr(cuts[i], cuts[i + 1] - cuts[i]);
+    summaries[i].end[0] = run_states(text, LineState::Code);
+    summaries[i].end[1] = run_states(text, LineState::String);
+  });
+
+  // keep the cuts which are outside string literals
+  std::vector<Segment> segments;
+  LineState state = LineState::Code;
+  for (std::size_t i{0}; i < summaries.size(); ++i)
+  {
+    if (state == LineState::Code)
+    {
+      if (!segments.empty())
+      {
+        segments.back().end = cuts[i];
+      }
+      segments.push_back(Segment{cuts[i], source.size()});
+    }
+    state = summaries[i].end[static_cast<int>(state)];
+  }
+
+  std::vector<SegmentResult> results(segments.size());
+  pool.parallel_for(segments.size(), [&](std::size_t i) {
+    const auto &segment = segments[i];
+    // every segment interns into and reports to its own context, they are
+    // merged in source order
+    CompilationContext segment_compilation{results[i].strings};
+    Scanner scanner{source.substr(0, segment.end), segment_compilation, segment.begin};
+    results[i].tokens = scanner.scan_tokens();
+    results[i].diagnostics = std::move(segment_compilation.diagnostics());
+  });
+
+  // stitch the segments together, renumbering literals and symbols and
+  // dropping the eof tokens of all but the last segment
+  TokenList list;
+  list.source = source;
+  list.strings = &compilation.strings();
+  // offsets of the segments are into the whole source, so are the diagnostics
+  compilation.source_map().reset(source);
+  list.source_map = &compilation.source_map();
+  std::size_t token_count = 0;
+  for (const auto &result : results)
+  {
+    token_count += result.tokens.tokens.size();
+  }
+  list.tokens.reserve(token_count);
+  for (std::size_t i{0}; i < results.size(); ++i)
+  {
+    auto &part = results[i].tokens;
+    auto number_base = static_cast<std::uint32_t>(list.literals.numbers.size());
+    std::vector<Symbol> symbols(results[i].strings.size());
+    for (Symbol symbol{0}; symbol < symbols.size(); ++symbol)
+    {
+      symbols[symbol] = compilation.strings().intern(results[i].strings.view(symbol));
+    }
+    bool last = i + 1 == results.size();
+    for (auto token : part.tokens)
+    {
+      if (token.type == TokenType::eof && !last) break;
+      if (token.type == TokenType::NUMBER) token.literal += number_base;
+      if (token.type == TokenType::STRING || token.type == TokenType::IDENTIFIER) token.literal = symbols[token.literal];
+      list.tokens.push_back(token);
+    }
+    list.literals.numbers.insert(list.literals.numbers.end(), part.literals.numbers.begin(), part.literals.numbers.end());
+    compilation.diagnostics().append(std::move(results[i].diagnostics));
+  }
+  return list;
+}
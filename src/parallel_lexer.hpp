@@ -0,0 +1,16 @@
+#pragma once
+
+#include "compilation_context.hpp"
+#include "lexer.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <string_view>
+
+/*
+ * Scans source on the threads of pool and produces exactly the TokenList and
+ * diagnostics the sequential Scanner would, errors go to compilation. The source is cut into chunks of
+ * roughly min_chunk_size bytes at line starts which are not inside a string
+ * literal; sources smaller than two chunks are scanned on the calling thread.
+ */
+TokenList scan_tokens_parallel(std::string_view source, CompilationContext &compilation, ThreadPool &pool,
+    std::size_t min_chunk_size = 1 << 20);
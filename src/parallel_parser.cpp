@@ -0,0 +1,65 @@
+#include "parallel_parser.hpp"
+
+#include <utility>
+
+ParallelParser::ParallelParser(const TokenList &tokens, StringTable &strings, ThreadPool &pool, std::size_t max_depth,
+                               std::size_t min_batch_tokens)
+{
+  std::vector<std::size_t> starts = Parser::expression_starts(tokens.tokens);
+
+  // cut in front of the first expression which starts min_batch_tokens or
+  // more behind the previous cut, the last batch runs up to and with the eof
+  std::vector<std::size_t> cuts;
+  for (std::size_t start : starts)
+  {
+    if (cuts.empty() || start - cuts.back() >= min_batch_tokens)
+    {
+      cuts.push_back(start);
+    }
+  }
+  if (cuts.empty())
+  {
+    cuts.push_back(0);
+  }
+  cuts.push_back(tokens.tokens.size());
+
+  m_batches.reserve(cuts.size() - 1);
+  for (std::size_t i{0}; i + 1 < cuts.size(); ++i)
+  {
+    std::size_t begin = cuts[i];
+    std::size_t end = cuts[i + 1];
+    m_batches.push_back(pool.submit([&tokens, &strings, max_depth, begin, end] {
+      // the parser only reads the strings, the symbols are in the tokens
+      CompilationContext compilation{strings};
+      TokenListStream stream{tokens, begin, end};
+      Parser parser{stream, compilation, max_depth};
+      Batch batch;
+      while (!parser.is_at_end())
+      {
+        Expr *expression = parser.parse();
+        if (expression == nullptr)
+        {
+          batch.failed = true;
+          break;
+        }
+        batch.roots.push_back(expression);
+      }
+      batch.diagnostics = std::move(compilation.diagnostics());
+      batch.arena = std::move(parser.arena());
+      return batch;
+    }));
+  }
+}
+
+ParallelParser::~ParallelParser()
+{
+  for (; m_next < m_batches.size(); ++m_next)
+  {
+    m_batches[m_next].wait();
+  }
+}
+
+ParallelParser::Batch ParallelParser::next()
+{
+  return m_batches[m_next++].get();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "arena.hpp"
+#include "compilation_context.hpp"
+#include "expr.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <future>
+#include <vector>
+
+/*
+ * Parses the top-level expressions of an already scanned TokenList on the
+ * threads of pool. Parser::expression_starts cuts the tokens into batches of
+ * whole expressions, every batch is parsed by a Parser of its own into an
+ * arena and diagnostics of its own, and the batches are handed out in source
+ * order. A batch stops at its first error like a sequential parser would,
+ * so reading batches up to the first failed one gives the same trees and
+ * errors as parsing the list in one go.
+ */
+class ParallelParser
+{
+public:
+  struct Batch
+  {
+    std::vector<Expr*> roots; // trees in source order, allocated in arena
+    bool failed{false};       // an expression after the roots has an error
+    Diagnostics diagnostics;
+    Arena arena;
+  };
+
+  // tokens and their strings are only read, they must outlive the parser
+  ParallelParser(const TokenList &tokens, StringTable &strings, ThreadPool &pool,
+                 std::size_t max_depth = Parser::default_max_depth, std::size_t min_batch_tokens = 1 << 12);
+
+  ParallelParser(const ParallelParser &) = delete;
+  ParallelParser &operator=(const ParallelParser &) = delete;
+
+  // waits for the batches still being parsed, they look at the tokens
+  ~ParallelParser();
+
+  [[nodiscard]] bool done() const
+  {
+    return m_next == m_batches.size();
+  }
+
+  // the next batch in source order, waits until it is parsed
+  Batch next();
+
+private:
+  std::vector<std::future<Batch>> m_batches;
+  std::size_t m_next{0};
+};
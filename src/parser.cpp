@@ -1,35 +1,137 @@
 #include "parser.hpp"
 
-#include <memory>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <utility>
 #include "expr.hpp"
 #include "lexer.hpp"
 
 using ExprNode = Parser::ExprNode;
 
-Parser::Parser(std::vector<Token> tokens) : m_tokens(std::move(tokens)), m_current(0)
+namespace
 {
+  #define CountToken(E) + 1
+  constexpr std::size_t token_type_count = 0 TokenFunc(CountToken);
+  #undef CountToken
+
+  // How tightly each binary operator holds on to its operands, 0 for tokens
+  // which are not binary operators. Unary operators bind tighter than all.
+  constexpr auto binding_powers = [] {
+    std::array<std::uint8_t, token_type_count> powers{};
+    auto set = [&powers](TokenType type, std::uint8_t power) { powers[static_cast<std::size_t>(type)] = power; };
+    set(TokenType::BANG_EQUAL, 1);
+    set(TokenType::EQAUL_EQUAL, 1);
+    set(TokenType::LESS, 2);
+    set(TokenType::LESS_EQUAL, 2);
+    set(TokenType::GREATER, 2);
+    set(TokenType::GREATER_EQUAL, 2);
+    set(TokenType::MINUS, 3);
+    set(TokenType::PLUS, 3);
+    set(TokenType::SLASH, 4);
+    set(TokenType::STAR, 4);
+    return powers;
+  }();
+
+  std::uint8_t binding_power(TokenType type)
+  {
+    return binding_powers[static_cast<std::size_t>(type)];
+  }
+}
+
+Parser::Parser(TokenStream &tokens, CompilationContext &compilation, std::size_t max_depth, HashCons *hash_cons)
+  : m_tokens(tokens), m_compilation(compilation), m_window{tokens.next(), Token{TokenType::eof, 0, 0, Token::no_literal}}, m_current(0),
+    m_max_depth(max_depth), m_hash_cons(hash_cons)
+{
+}
+
+std::vector<std::size_t> Parser::expression_starts(const std::vector<Token> &tokens)
+{
+  std::vector<std::size_t> starts;
+  std::size_t depth{0}; // parentheses open
+  bool open{false};     // an expression has started and not ended yet
+  bool operand{false};  // an operand is complete, an operator may follow
+  for (std::size_t i{0}; i < tokens.size() && tokens[i].type != TokenType::eof;)
+  {
+    TokenType type = tokens[i].type;
+    if (operand)
+    {
+      if (binding_power(type) != 0)
+      {
+        operand = false;
+      }
+      else if (type == TokenType::RIGHT_PAREN && depth > 0)
+      {
+        --depth;
+      }
+      else if (depth > 0)
+      {
+        break; // missing closing parenthesis
+      }
+      else
+      {
+        // the expression ends here, look at the token again as the start
+        // of the next one
+        open = false;
+        operand = false;
+        continue;
+      }
+      ++i;
+      continue;
+    }
+
+    if (!open)
+    {
+      starts.push_back(i);
+      open = true;
+    }
+    switch (type)
+    {
+      case TokenType::BANG:
+      case TokenType::MINUS: break;
+      case TokenType::LEFT_PAREN: ++depth; break;
+      case TokenType::FALSE:
+      case TokenType::TRUE:
+      case TokenType::NIL:
+      case TokenType::NUMBER:
+      case TokenType::STRING: operand = true; break;
+      default: return starts; // expected expression
+    }
+    ++i;
+  }
+  return starts;
 }
 
 Token& Parser::peek()
 {
-  return m_tokens[m_current];
+  return m_window[m_current];
 }
 
 Token& Parser::previous()
 {
-  return m_tokens[m_current - 1];
+  return m_window[(m_current + lookahead - 1) % lookahead];
 }
 
 Token& Parser::advance()
 {
   if (!is_at_end())
   {
-    ++m_current;
+    m_current = (m_current + 1) % lookahead;
+    m_window[m_current] = m_tokens.next();
   }
   return previous();
 }
 
+void Parser::release()
+{
+  if (m_hash_cons == nullptr)
+  {
+    m_arena.release();
+  }
+  m_tokens.release_before(peek());
+}
+
 bool Parser::is_at_end()
 {
   return peek().type == TokenType::eof;
@@ -53,9 +155,9 @@ Token& Parser::consume(const TokenType &type, const std::string &message)
 ParserException Parser::error(const Token &token, const std::string &message)
 {
   if (token.type == TokenType::eof) {
-    report(token.line, " at end", message);
+    m_compilation.diagnostics().error(token.offset, " at end", message);
   } else {
-    report(token.line, " at '" + token.lexeme + "'", message);
+    m_compilation.diagnostics().error(token.offset, " at '" + std::string(m_tokens.context().lexeme(token)) + "'", message);
   }
   return ParserException(message);
 }
@@ -86,6 +188,18 @@ void Parser::synchronize()
   }
 }
 
+Value Parser::literal_value(const Token &token)
+{
+  switch (token.type)
+  {
+    case TokenType::NUMBER: return Value::number(m_tokens.context().number(token));
+    case TokenType::STRING: return Value::string(token.literal);
+    case TokenType::TRUE: return Value::boolean(true);
+    case TokenType::FALSE: return Value::boolean(false);
+    default: return Value::nil();
+  }
+}
+
 template<typename... Args>
 bool Parser::match(const TokenType &type, Args... rest)
 {
@@ -104,89 +218,151 @@ bool Parser::match(const TokenType &type, Args... rest)
 
 ExprNode Parser::expression()
 {
-  return equality();
+  // Precedence climbing: operands are parsed in a loop and every operator
+  // waits on m_frames until an operator binding less tightly, a closing
+  // parenthesis or the end of the expression comes along. Binary operators
+  // are left associative, so an operator reduces the waiting ones of the
+  // same power.
+  std::size_t base = m_frames.size();
+  while (true)
+  {
+    while (true)
+    {
+      if (match(TokenType::BANG, TokenType::MINUS))
+      {
+        push(Frame{Frame::Kind::Unary, 0, previous(), Operand{nullptr, 0}});
+      }
+      else if (match(TokenType::LEFT_PAREN))
+      {
+        push(Frame{Frame::Kind::Group, 0, previous(), Operand{nullptr, 0}});
+      }
+      else
+      {
+        break;
+      }
+    }
+    Operand operand{primary(), 1};
+
+    while (true)
+    {
+      operand = reduce_unary(operand);
+      std::uint8_t power = binding_power(peek().type);
+      if (power != 0)
+      {
+        operand = reduce_binary(operand, power);
+        push(Frame{Frame::Kind::Binary, power, advance(), operand});
+        break;
+      }
+
+      operand = reduce_binary(operand, 1);
+      if (m_frames.size() == base)
+      {
+        return operand.node;
+      }
+      consume(TokenType::RIGHT_PAREN, "Expected closing paranthesis");
+      std::size_t height = nest(m_frames.back().op, operand.height);
+      m_frames.pop_back();
+      operand = Operand{make_grouping(operand.node), height};
+    }
+  }
 }
 
-ExprNode Parser::equality()
+void Parser::push(const Frame &frame)
 {
-  auto expr = comparison();
-  while (match(TokenType::BANG_EQUAL, TokenType::EQAUL_EQUAL))
+  if (m_frames.size() >= m_max_depth)
   {
-    Token op = previous();
-    ExprNode right = comparison();
-    expr = std::make_unique<Binary>(std::move(expr), op, std::move(right));
+    throw error(frame.op, "Expression nested too deeply");
   }
-  return expr;
+  m_frames.push_back(frame);
 }
 
-ExprNode Parser::comparison()
+std::size_t Parser::nest(const Token &op, std::size_t height)
 {
-  auto expr = term();
-  while (match(TokenType::LESS, TokenType::LESS_EQUAL, TokenType::GREATER, TokenType::GREATER_EQUAL))
+  // a left associative chain waits on a single frame, so push() alone does
+  // not bound how deep the tree gets
+  if (height >= m_max_depth)
   {
-    auto op = previous();
-    auto right = term();
-    expr = std::make_unique<Binary>(std::move(expr), op, std::move(right));
+    throw error(op, "Expression nested too deeply");
   }
-  return expr;
+  return height + 1;
 }
 
-ExprNode Parser::term()
+Parser::Operand Parser::reduce_unary(Operand operand)
 {
-  auto expr = factor();
-  while (match(TokenType::MINUS, TokenType::PLUS))
+  while (!m_frames.empty() && m_frames.back().kind == Frame::Kind::Unary)
   {
-    auto op = previous();
-    auto right = factor();
-    expr = std::make_unique<Binary>(std::move(expr), op, std::move(right));
+    const Frame &frame = m_frames.back();
+    std::size_t height = nest(frame.op, operand.height);
+    operand = Operand{make_unary(frame.op, operand.node), height};
+    m_frames.pop_back();
   }
-  return expr;
+  return operand;
 }
 
-ExprNode Parser::factor()
+Parser::Operand Parser::reduce_binary(Operand operand, std::uint8_t power)
 {
-  auto expr = unary();
-  while (match(TokenType::SLASH, TokenType::STAR))
+  while (!m_frames.empty() && m_frames.back().kind == Frame::Kind::Binary && m_frames.back().power >= power)
   {
-    auto op = previous();
-    auto right = unary();
-    expr = std::make_unique<Binary>(std::move(expr), op, std::move(right));
+    const Frame &frame = m_frames.back();
+    std::size_t height = nest(frame.op, std::max(frame.left.height, operand.height));
+    operand = Operand{make_binary(frame.left.node, frame.op, operand.node), height};
+    m_frames.pop_back();
   }
-  return expr;
+  return operand;
 }
 
-ExprNode Parser::unary()
+ExprNode Parser::primary()
 {
-  while (match(TokenType::BANG, TokenType::MINUS))
+  if (match(TokenType::FALSE, TokenType::TRUE, TokenType::NIL, TokenType::NUMBER, TokenType::STRING))
   {
-    auto op = previous();
-    auto right = unary();
-    return std::make_unique<Unary>(op, std::move(right));
+    return make_literal(previous());
   }
-  return primary();
+  throw error(peek(), "Expected expression");
 }
 
-ExprNode Parser::primary()
+ExprNode Parser::make_literal(const Token &token)
 {
-  if (match(TokenType::FALSE, TokenType::TRUE, TokenType::NIL, TokenType::NUMBER, TokenType::STRING))
+  if (m_hash_cons != nullptr)
   {
-    return std::make_unique<Literal>(previous());
+    return m_hash_cons->literal(m_arena, token, literal_value(token), m_tokens.context().lexeme(token));
   }
-  if (match(TokenType::LEFT_PAREN))
+  return m_arena.make<Literal>(token, literal_value(token));
+}
+
+ExprNode Parser::make_grouping(ExprNode expression)
+{
+  if (m_hash_cons != nullptr)
   {
-    ExprNode expr = expression();
-    consume(TokenType::RIGHT_PAREN, "Expected closing paranthesis");
-    return std::make_unique<Grouping>(std::move(expr));
+    return m_hash_cons->grouping(m_arena, expression);
   }
-  throw error(peek(), "Expected expression");
+  return m_arena.make<Grouping>(expression);
+}
+
+ExprNode Parser::make_unary(const Token &op, ExprNode right)
+{
+  if (m_hash_cons != nullptr)
+  {
+    return m_hash_cons->unary(m_arena, op, right);
+  }
+  return m_arena.make<Unary>(op, right);
+}
+
+ExprNode Parser::make_binary(ExprNode left, const Token &op, ExprNode right)
+{
+  if (m_hash_cons != nullptr)
+  {
+    return m_hash_cons->binary(m_arena, left, op, right);
+  }
+  return m_arena.make<Binary>(left, op, right);
 }
 
 ExprNode Parser::parse()
 { 
+  m_frames.clear();
   try {
     return expression();
-  } catch (const ParserException& parse_exception) {
-    std::cout << parse_exception.what() << "\n";
+  } catch (const ParserException&) {
+    // already reported to the diagnostics
   }
   return nullptr;
 }
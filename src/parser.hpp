@@ -1,9 +1,16 @@
 #pragma once
 
+#include "arena.hpp"
 #include "common.hpp"
+#include "compilation_context.hpp"
 #include "lexer.hpp"
 #include "expr.hpp"
-#include <memory>
+#include "hash_cons.hpp"
+#include "value.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 struct ParserException : LoxException
 {
@@ -15,23 +22,88 @@ struct ParserException : LoxException
 class Parser
 {
 public:
-  using ExprNode = std::unique_ptr<Expr>;
+  // Nodes are owned by the parser's arena and stay valid until the arena is
+  // released or the parser is destroyed
+  using ExprNode = Expr*;
+
+  // Height of the deepest tree parse() builds. The interpreter, compiler,
+  // passes and printer still recurse over the tree, so the limit may be
+  // lowered but not raised past what they get through on an 8 MiB stack.
+  static constexpr std::size_t max_supported_depth = 10000;
+  static constexpr std::size_t default_max_depth = max_supported_depth;
 
 public:
-  explicit Parser(std::vector<Token> tokens);
+  // Index of the first token of every top-level expression in tokens, found
+  // from the token types alone the same way parse() would split them. Stops
+  // at the first token parse() would fail at, whatever follows belongs to the
+  // expression started last.
+  static std::vector<std::size_t> expression_starts(const std::vector<Token> &tokens);
+
+  // Tokens are pulled from the stream while parsing, the stream must outlive
+  // the parser. The scanner already interned string literals, the parser
+  // only reads the symbols the tokens carry. Errors go to the diagnostics of
+  // compilation. With a hash_cons table nodes are built through it and
+  // identical subtrees are shared, also between the trees of different
+  // expressions.
+  Parser(TokenStream &tokens, CompilationContext &compilation, std::size_t max_depth = default_max_depth,
+         HashCons *hash_cons = nullptr);
 
+  // parse one expression, nullptr if it has an error. The error is the last
+  // one in the diagnostics and the parser stays at the token it failed at.
   ExprNode parse();
 
-  ExprNode expression();
-  ExprNode equality();
-  ExprNode comparison();
-  ExprNode term();
-  ExprNode factor();
-  ExprNode unary();
-  ExprNode primary();
   bool is_at_end();
 
+  // Drop the trees parsed so far together with the state the token stream
+  // keeps for them. When hash consing the trees are kept, later ones may
+  // share their nodes.
+  void release();
+
+  Arena& arena()
+  {
+    return m_arena;
+  }
+
 private:
+  // a parsed subtree and the number of nodes on its longest path
+  struct Operand
+  {
+    ExprNode node;
+    std::size_t height;
+  };
+
+  // An operator or parenthesis waiting for the operand to its right. Frames
+  // live on m_frames instead of the call stack, so nesting is only bounded
+  // by max_depth.
+  struct Frame
+  {
+    enum class Kind : std::uint8_t
+    {
+      Unary,
+      Binary,
+      Group,
+    };
+
+    Kind kind;
+    std::uint8_t power; // binding power of a Binary operator
+    Token op;
+    Operand left;       // left operand of a Binary operator
+  };
+
+  ExprNode expression();
+  ExprNode primary();
+  void push(const Frame &frame);
+  // height of a node for op above a subtree of the given height, throws
+  // when it would be more than max_depth
+  std::size_t nest(const Token &op, std::size_t height);
+  // apply the operators waiting on the stack to operand
+  Operand reduce_unary(Operand operand);
+  Operand reduce_binary(Operand operand, std::uint8_t power);
+  ExprNode make_literal(const Token &token);
+  ExprNode make_grouping(ExprNode expression);
+  ExprNode make_unary(const Token &op, ExprNode right);
+  ExprNode make_binary(ExprNode left, const Token &op, ExprNode right);
+
   Token& peek();
   Token& previous();
   Token& advance();
@@ -40,9 +112,19 @@ private:
   template<typename... Args>
   bool match(const TokenType &type, Args... rest);
   void synchronize();
+  Value literal_value(const Token &token);
+
+  ParserException error(const Token &token, const std::string &message);
 
-  static ParserException error(const Token &token, const std::string &message);
+  // peek() and previous() are all the lookahead the grammar needs
+  static constexpr int lookahead = 2;
 
-  std::vector<Token> m_tokens;
-  int m_current;
+  TokenStream &m_tokens;
+  CompilationContext &m_compilation;
+  std::array<Token, lookahead> m_window;
+  int m_current; // slot of peek() in m_window
+  std::vector<Frame> m_frames;
+  std::size_t m_max_depth;
+  HashCons *m_hash_cons;
+  Arena m_arena;
 };
@@ -2,48 +2,94 @@
 
 #include "expr.hpp"
 #include "lexer.hpp"
-#include <any>
-#include <format>
-#include <memory>
+#include "value.hpp"
+#include <ostream>
+#include <sstream>
+#include <streambuf>
 #include <string>
+#include <string_view>
 
-struct AstPrinter : public ExprVisitor
+/*
+ * Writes trees in prefix form straight into the buffer of a stream, every
+ * node appends to the same output so no intermediate strings are built.
+ */
+struct AstPrinter : public ExprVisitor<AstPrinter, void>
 {
+  explicit AstPrinter(const TokenContext &tokens) : m_tokens(tokens)
+  {
+  }
+
+  void print(Expr &expr, std::ostream &out)
+  {
+    m_out = out.rdbuf();
+    visit(expr);
+  }
+
   std::string print(Expr &expr)
   {
-    return std::any_cast<std::string>(expr.accept(*this));
+    std::ostringstream out;
+    print(expr, out);
+    return std::move(out).str();
   }
 
-  std::any visit_binary(Binary &expr) override
+  void visit_binary(Binary &expr)
   {
-    return parenthesize(expr.op.lexeme, {*(expr.left), *(expr.right)});
+    open(m_tokens.lexeme(expr.op));
+    argument(*expr.left);
+    argument(*expr.right);
+    close();
   }
-  std::any visit_grouping(Grouping &expr) override
+  void visit_grouping(Grouping &expr)
   {
-    return parenthesize("group", {*(expr.expression)});
+    open("group");
+    argument(*expr.expression);
+    close();
   }
-  std::any visit_literal(Literal &expr) override
+  void visit_literal(Literal &expr)
   {
-    if (expr.value.type == TokenType::STRING || expr.value.type == TokenType::NUMBER)
+    if (expr.value.is_synthetic())
     {
-      return expr.value.lexeme;
+      write_value(*m_out, expr.constant, *m_tokens.strings);
+    }
+    else if (expr.value.type == TokenType::STRING || expr.value.type == TokenType::NUMBER)
+    {
+      write(m_tokens.lexeme(expr.value));
+    }
+    else
+    {
+      write("nil");
     }
-    return std::string("nil");
   }
-  std::any visit_unary(Unary &expr) override
+  void visit_unary(Unary &expr)
   {
-    return parenthesize(expr.op.lexeme, {*(expr.right)});
+    open(m_tokens.lexeme(expr.op));
+    argument(*expr.right);
+    close();
   }
 
-  std::string parenthesize(const std::string &name, const std::vector<std::reference_wrapper<Expr>>& arg)
+private:
+  void open(std::string_view name)
   {
-    std::string str = std::format("({}", name);
-    for(const auto &expr : arg)
-    {
-      auto ss = expr.get().accept(*this);
-      str += std::format(" {}", std::any_cast<std::string>(ss));
-    }
-    str += ")";
-    return str;
+    m_out->sputc('(');
+    write(name);
+  }
+
+  void argument(Expr &expr)
+  {
+    m_out->sputc(' ');
+    visit(expr);
   }
+
+  void close()
+  {
+    m_out->sputc(')');
+  }
+
+  void write(std::string_view text)
+  {
+    m_out->sputn(text.data(), static_cast<std::streamsize>(text.size()));
+  }
+
+  const TokenContext &m_tokens;
+  std::streambuf *m_out{nullptr};
 };
@@ -0,0 +1,241 @@
+#include "scan_kernels.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LOX_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+  bool is_whitespace(char c)
+  {
+    return c == ' ' || c == '\r' || c == '\t' || c == '\n';
+  }
+
+  bool is_identifier(char c)
+  {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+  }
+
+  std::size_t scalar_skip_whitespace(const char *data, std::size_t size, std::size_t pos)
+  {
+    while (pos < size && is_whitespace(data[pos])) ++pos;
+    return pos;
+  }
+
+  std::size_t scalar_find_newline(const char *data, std::size_t size, std::size_t pos)
+  {
+    while (pos < size && data[pos] != '\n') ++pos;
+    return pos;
+  }
+
+  std::size_t scalar_find_quote(const char *data, std::size_t size, std::size_t pos)
+  {
+    while (pos < size && data[pos] != '"') ++pos;
+    return pos;
+  }
+
+  std::size_t scalar_skip_identifier(const char *data, std::size_t size, std::size_t pos)
+  {
+    while (pos < size && is_identifier(data[pos])) ++pos;
+    return pos;
+  }
+
+#ifdef LOX_SCAN_X86
+  /*
+   * SSE2 versions, 16 bytes per step. Signed byte compares are fine for the
+   * range checks since bytes >= 0x80 compare below every ASCII bound.
+   */
+  inline __m128i sse2_in_range(__m128i bytes, char low, char high)
+  {
+    return _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(low - 1)),
+        _mm_cmplt_epi8(bytes, _mm_set1_epi8(high + 1)));
+  }
+
+  std::size_t sse2_skip_whitespace(const char *data, std::size_t size, std::size_t pos)
+  {
+    for (; pos + 16 <= size; pos += 16)
+    {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+      __m128i space = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))),
+          _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))));
+      unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(space)) & 0xffff;
+      if (stop != 0)
+      {
+        return pos + __builtin_ctz(stop);
+      }
+    }
+    return scalar_skip_whitespace(data, size, pos);
+  }
+
+  std::size_t sse2_find_newline(const char *data, std::size_t size, std::size_t pos)
+  {
+    for (; pos + 16 <= size; pos += 16)
+    {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+      unsigned found = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+      if (found != 0)
+      {
+        return pos + __builtin_ctz(found);
+      }
+    }
+    return scalar_find_newline(data, size, pos);
+  }
+
+  std::size_t sse2_find_quote(const char *data, std::size_t size, std::size_t pos)
+  {
+    for (; pos + 16 <= size; pos += 16)
+    {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+      unsigned found = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')));
+      if (found != 0)
+      {
+        return pos + __builtin_ctz(found);
+      }
+    }
+    return scalar_find_quote(data, size, pos);
+  }
+
+  std::size_t sse2_skip_identifier(const char *data, std::size_t size, std::size_t pos)
+  {
+    for (; pos + 16 <= size; pos += 16)
+    {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+      __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20)); // folds A-Z onto a-z
+      __m128i ident = _mm_or_si128(
+          _mm_or_si128(sse2_in_range(lower, 'a', 'z'), sse2_in_range(bytes, '0', '9')),
+          _mm_cmpeq_epi8(bytes, _mm_set1_epi8('_')));
+      unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(ident)) & 0xffff;
+      if (stop != 0)
+      {
+        return pos + __builtin_ctz(stop);
+      }
+    }
+    return scalar_skip_identifier(data, size, pos);
+  }
+
+  /*
+   * AVX2 versions, 32 bytes per step, compiled for avx2 only in this
+   * function scope and only called after checking the cpu supports it.
+   */
+#define LOX_AVX2 __attribute__((target("avx2")))
+
+  LOX_AVX2 inline __m256i avx2_in_range(__m256i bytes, char low, char high)
+  {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(low - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), bytes));
+  }
+
+  LOX_AVX2 std::size_t avx2_skip_whitespace(const char *data, std::size_t size, std::size_t pos)
+  {
+    for (; pos + 32 <= size; pos += 32)
+    {
+      __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+      __m256i space = _mm256_or_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')),
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t'))),
+          _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r')),
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'))));
+      unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(space));
+      if (stop != 0)
+      {
+        return pos + __builtin_ctz(stop);
+      }
+    }
+    return sse2_skip_whitespace(data, size, pos);
+  }
+
+  LOX_AVX2 std::size_t avx2_find_newline(const char *data, std::size_t size, std::size_t pos)
+  {
+    for (; pos + 32 <= size; pos += 32)
+    {
+      __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+      unsigned found = _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')));
+      if (found != 0)
+      {
+        return pos + __builtin_ctz(found);
+      }
+    }
+    return sse2_find_newline(data, size, pos);
+  }
+
+  LOX_AVX2 std::size_t avx2_find_quote(const char *data, std::size_t size, std::size_t pos)
+  {
+    for (; pos + 32 <= size; pos += 32)
+    {
+      __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+      unsigned found = _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"')));
+      if (found != 0)
+      {
+        return pos + __builtin_ctz(found);
+      }
+    }
+    return sse2_find_quote(data, size, pos);
+  }
+
+  LOX_AVX2 std::size_t avx2_skip_identifier(const char *data, std::size_t size, std::size_t pos)
+  {
+    for (; pos + 32 <= size; pos += 32)
+    {
+      __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+      __m256i lower = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20)); // folds A-Z onto a-z
+      __m256i ident = _mm256_or_si256(
+          _mm256_or_si256(avx2_in_range(lower, 'a', 'z'), avx2_in_range(bytes, '0', '9')),
+          _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('_')));
+      unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(ident));
+      if (stop != 0)
+      {
+        return pos + __builtin_ctz(stop);
+      }
+    }
+    return sse2_skip_identifier(data, size, pos);
+  }
+
+#undef LOX_AVX2
+#endif
+
+  constexpr ScanKernels scalar_kernels{ScanKernels::Isa::Scalar, scalar_skip_whitespace, scalar_find_newline,
+    scalar_find_quote, scalar_skip_identifier};
+#ifdef LOX_SCAN_X86
+  constexpr ScanKernels sse2_kernels{ScanKernels::Isa::SSE2, sse2_skip_whitespace, sse2_find_newline,
+    sse2_find_quote, sse2_skip_identifier};
+  constexpr ScanKernels avx2_kernels{ScanKernels::Isa::AVX2, avx2_skip_whitespace, avx2_find_newline,
+    avx2_find_quote, avx2_skip_identifier};
+#endif
+}
+
+const ScanKernels& ScanKernels::get(Isa isa)
+{
+#ifdef LOX_SCAN_X86
+  switch (isa)
+  {
+    case Isa::AVX2:
+      if (__builtin_cpu_supports("avx2"))
+      {
+        return avx2_kernels;
+      }
+      return sse2_kernels;
+    case Isa::SSE2: return sse2_kernels; // part of the x86-64 baseline
+    case Isa::Scalar: break;
+  }
+#endif
+  return scalar_kernels;
+}
+
+const ScanKernels& ScanKernels::best()
+{
+  static const ScanKernels &kernels = get(Isa::AVX2);
+  return kernels;
+}
+
+const char* to_string(ScanKernels::Isa isa)
+{
+  switch (isa)
+  {
+    case ScanKernels::Isa::Scalar: return "scalar";
+    case ScanKernels::Isa::SSE2: return "sse2";
+    case ScanKernels::Isa::AVX2: return "avx2";
+  }
+  return "unknown";
+}
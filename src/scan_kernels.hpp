@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+ * Kernels used by the Scanner to skip over long runs of bytes: whitespace,
+ * comment bodies, string bodies and identifier tails. Every kernel takes the
+ * source as data/size, starts at pos and returns the position of the first
+ * byte that ends the run (size if the run reaches the end). Lines are not
+ * counted here, the SourceMap finds them when a diagnostic needs one.
+ */
+struct ScanKernels
+{
+  enum class Isa
+  {
+    Scalar,
+    SSE2,
+    AVX2,
+  };
+
+  Isa isa;
+
+  // first byte which is not ' ', '\r', '\t' or '\n'
+  std::size_t (*skip_whitespace)(const char *data, std::size_t size, std::size_t pos);
+  // first '\n'
+  std::size_t (*find_newline)(const char *data, std::size_t size, std::size_t pos);
+  // first '"'
+  std::size_t (*find_quote)(const char *data, std::size_t size, std::size_t pos);
+  // first byte which is not [A-Za-z0-9_]
+  std::size_t (*skip_identifier)(const char *data, std::size_t size, std::size_t pos);
+
+  // best kernels supported by the running cpu, selected once
+  static const ScanKernels& best();
+
+  // kernels for a specific instruction set, falls back to scalar when the
+  // cpu or the build does not support it
+  static const ScanKernels& get(Isa isa);
+};
+
+const char* to_string(ScanKernels::Isa isa);
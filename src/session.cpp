@@ -0,0 +1,338 @@
+#include "session.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include "parser.hpp"
+
+namespace
+{
+
+// first byte the scanner looked at for token, STRING lexemes exclude the quotes
+std::size_t lexeme_begin(const Token &token)
+{
+  return token.offset - (token.type == TokenType::STRING ? 1 : 0);
+}
+
+// the scanner decided where token ends by looking at the byte at this offset
+std::size_t lexeme_end(const Token &token)
+{
+  return token.offset + token.length + (token.type == TokenType::STRING ? 1 : 0);
+}
+
+bool has_literal(const Token &token)
+{
+  return token.type == TokenType::NUMBER;
+}
+
+// a string still open at the end of the source is left in the lexeme of eof
+bool ends_in_open_string(const std::vector<Token> &tokens)
+{
+  return tokens.back().length > 0;
+}
+
+/*
+ * Streams the session's tokens from a given index on and remembers which
+ * token was handed out last, after parse() that is the parser's peek().
+ */
+class SessionTokenStream : public TokenStream
+{
+public:
+  SessionTokenStream(const TokenList &tokens, std::size_t first) : m_tokens(tokens), m_next(first)
+  {
+  }
+
+  Token next() override
+  {
+    m_last = m_next;
+    if (m_next + 1 < m_tokens.tokens.size())
+    {
+      ++m_next;
+    }
+    return m_tokens.tokens[m_last];
+  }
+
+  const TokenContext& context() const override
+  {
+    return m_tokens;
+  }
+
+  [[nodiscard]] std::size_t last() const
+  {
+    return m_last;
+  }
+
+private:
+  const TokenList &m_tokens;
+  std::size_t m_next;
+  std::size_t m_last{0};
+};
+
+} // namespace
+
+Session::Session(Handler handler) : m_handler(std::move(handler))
+{
+  reset();
+}
+
+void Session::reset()
+{
+  m_source.clear();
+  m_tokens.source = m_source;
+  m_tokens.literals = LiteralTable{};
+  m_tokens.strings = &m_strings;
+  m_tokens.source_map = &m_compilation.source_map();
+  m_compilation.source_map().reset(m_source);
+  m_tokens.tokens.assign(1, Token{TokenType::eof, 0, 0, Token::no_literal});
+  m_live_literals = 0;
+  m_expressions.clear();
+}
+
+void Session::edit(std::size_t offset, std::size_t length, std::string_view text)
+{
+  if (offset > m_source.size() || length > m_source.size() - offset)
+  {
+    throw SessionException("Edit outside of the buffer");
+  }
+
+  std::string removed = m_source.substr(offset, length);
+  Damage damage;
+  {
+    Stats::Scope scope{m_stats, Stats::Phase::Scan};
+    damage = relex(offset, length, text, true);
+  }
+  if (ends_in_open_string(m_tokens.tokens))
+  {
+    // the string would swallow everything typed after it, report it once
+    // and put the buffer back the way it was
+    m_compilation.diagnostics().flush(*Output::diagnostics, m_compilation.source_map());
+    Stats::Scope scope{m_stats, Stats::Phase::Scan};
+    relex(offset, text.size(), removed, false);
+    return;
+  }
+  std::vector<std::string> failures;
+  std::vector<Expr*> changed = reparse(damage, failures);
+  // like a script, a failed parse is echoed to the results after its report
+  m_compilation.diagnostics().flush(*Output::diagnostics, m_compilation.source_map());
+  for (const std::string &failure : failures)
+  {
+    *Output::results << failure << "\n";
+  }
+  for (Expr *expression : changed)
+  {
+    m_handler(*expression, m_tokens);
+  }
+  m_arena.release();
+}
+
+Session::Damage Session::relex(std::size_t offset, std::size_t length, std::string_view text, bool report)
+{
+  std::vector<Token> &tokens = m_tokens.tokens;
+
+  // first token whose scan looked at a changed byte, a NUMBER looks two
+  // bytes ahead when it is followed by a '.'
+  auto damaged = std::partition_point(tokens.begin(), tokens.end(),
+                                      [offset](const Token &token) { return lexeme_end(token) < offset; });
+  std::size_t first = damaged - tokens.begin();
+  if (first > 0)
+  {
+    const Token &previous = tokens[first - 1];
+    if (previous.type == TokenType::NUMBER && lexeme_end(previous) + 1 >= offset && m_source[lexeme_end(previous)] == '.')
+    {
+      --first;
+    }
+  }
+
+  std::size_t removed_end = offset + length;
+  std::ptrdiff_t byte_delta = static_cast<std::ptrdiff_t>(text.size()) - static_cast<std::ptrdiff_t>(length);
+
+  std::size_t restart = first > 0 ? lexeme_end(tokens[first - 1]) : 0;
+  m_source.replace(offset, length, text);
+  m_tokens.source = m_source;
+
+  // Only tokens made entirely of bytes behind the edit can line up with a
+  // new token. Once one does, the scanner is in the state it was in when it
+  // produced the old token and the rest of the old list is still right.
+  std::size_t old = std::partition_point(tokens.begin() + first, tokens.end(),
+                                         [removed_end](const Token &token) { return lexeme_begin(token) < removed_end; }) -
+                    tokens.begin();
+  auto shifted_begin = [byte_delta](const Token &token) {
+    return static_cast<std::ptrdiff_t>(lexeme_begin(token)) + byte_delta;
+  };
+
+  m_compilation.source_map().reset(m_source);
+  // the bytes between restart and the edit scan as they did before, errors
+  // found there were already reported
+  CompilationContext scanned{m_strings};
+  Scanner scanner{m_source, scanned, restart};
+  std::vector<Token> fresh;
+  while (true)
+  {
+    Token token = scanner.next();
+    while (old < tokens.size() && shifted_begin(tokens[old]) < static_cast<std::ptrdiff_t>(lexeme_begin(token)))
+    {
+      ++old;
+    }
+    if (old < tokens.size() && tokens[old].type == token.type && tokens[old].length == token.length &&
+        shifted_begin(tokens[old]) == static_cast<std::ptrdiff_t>(lexeme_begin(token)))
+    {
+      break;
+    }
+    if (has_literal(token))
+    {
+      token.literal = adopt_literal(token, scanner.context());
+    }
+    fresh.push_back(token);
+    if (token.type == TokenType::eof)
+    {
+      old = tokens.size();
+      break;
+    }
+  }
+  if (m_stats != nullptr)
+  {
+    m_stats->add_tokens(fresh.size());
+    m_stats->add_source_bytes(text.size());
+  }
+  for (const Diagnostic &diagnostic : scanned.diagnostics().pending())
+  {
+    if (report && diagnostic.offset >= offset)
+    {
+      m_compilation.diagnostics().error(diagnostic.offset, diagnostic.where, diagnostic.message);
+    }
+  }
+
+  for (std::size_t index{old}; index < tokens.size(); ++index)
+  {
+    tokens[index].offset += byte_delta;
+  }
+  m_live_literals -= std::count_if(tokens.begin() + first, tokens.begin() + old, has_literal);
+  tokens.erase(tokens.begin() + first, tokens.begin() + old);
+  tokens.insert(tokens.begin() + first, fresh.begin(), fresh.end());
+  if (m_tokens.literals.numbers.size() > 2 * m_live_literals + 64)
+  {
+    compact_literals();
+  }
+
+  return Damage{first, first + fresh.size(),
+                static_cast<std::ptrdiff_t>(fresh.size()) - static_cast<std::ptrdiff_t>(old - first)};
+}
+
+std::vector<Expr*> Session::reparse(const Damage &damage, std::vector<std::string> &failures)
+{
+  const std::vector<Token> &tokens = m_tokens.tokens;
+
+  // An expression ends where the parser's peek() stopped matching, so the
+  // first expression whose parse looked at a damaged token starts over
+  auto begin = std::partition_point(m_expressions.begin(), m_expressions.end(),
+                                    [&damage](const Expression &expression) { return expression.seen < damage.first; });
+  std::size_t position = begin != m_expressions.end() ? begin->first
+                         : m_expressions.empty()      ? 0
+                                                      : m_expressions.back().end;
+  // old expressions starting behind the damage, one of them is where parsing
+  // can stop
+  std::size_t old_damage_end = damage.end - damage.delta;
+  auto old = std::partition_point(begin, m_expressions.end(),
+                                  [old_damage_end](const Expression &expression) { return expression.first < old_damage_end; });
+
+  std::vector<Expression> fresh;
+  std::vector<Expr*> changed;
+  std::optional<SessionTokenStream> stream;
+  std::optional<Parser> parser;
+  bool synced{false};
+  {
+    Stats::Scope scope{m_stats, Stats::Phase::Parse};
+    while (tokens[position].type != TokenType::eof)
+    {
+      if (position >= damage.end)
+      {
+        auto shifted = static_cast<std::ptrdiff_t>(position) - damage.delta;
+        while (old != m_expressions.end() && old->first < shifted)
+        {
+          ++old;
+        }
+        if (old != m_expressions.end() && old->first == shifted)
+        {
+          synced = true;
+          break;
+        }
+      }
+      if (!parser)
+      {
+        stream.emplace(m_tokens, position);
+        parser.emplace(*stream, m_compilation);
+        parser->arena() = std::move(m_arena);
+      }
+
+      Expr *expression = parser->parse();
+      if (expression != nullptr)
+      {
+        auto end = static_cast<std::uint32_t>(stream->last());
+        fresh.push_back(Expression{static_cast<std::uint32_t>(position), end, end, false});
+        // an expression the damage did not reach is the tree handled before
+        bool same = begin != m_expressions.end() && begin->first == position && begin->end == stream->last() &&
+                    !begin->failed && begin->end <= damage.first;
+        if (!same)
+        {
+          changed.push_back(expression);
+        }
+      }
+      else
+      {
+        // skip the token the parser gave up at and start over behind it
+        std::size_t bad = stream->last();
+        std::size_t end = tokens[bad].type == TokenType::eof ? bad : bad + 1;
+        fresh.push_back(Expression{static_cast<std::uint32_t>(position), static_cast<std::uint32_t>(end),
+                                   static_cast<std::uint32_t>(bad), true});
+        failures.push_back(m_compilation.diagnostics().pending().back().message);
+        m_arena = std::move(parser->arena());
+        parser.reset();
+      }
+      position = fresh.back().end;
+    }
+    if (parser)
+    {
+      m_arena = std::move(parser->arena());
+    }
+  }
+  if (m_stats != nullptr)
+  {
+    m_stats->add_nodes(m_arena.allocation_count());
+  }
+
+  std::vector<Expression> kept;
+  if (synced)
+  {
+    for (; old != m_expressions.end(); ++old)
+    {
+      kept.push_back(Expression{static_cast<std::uint32_t>(old->first + damage.delta),
+                                static_cast<std::uint32_t>(old->end + damage.delta),
+                                static_cast<std::uint32_t>(old->seen + damage.delta), old->failed});
+    }
+  }
+  m_expressions.erase(begin, m_expressions.end());
+  m_expressions.insert(m_expressions.end(), fresh.begin(), fresh.end());
+  m_expressions.insert(m_expressions.end(), kept.begin(), kept.end());
+  return changed;
+}
+
+std::uint32_t Session::adopt_literal(const Token &token, const TokenContext &scanned)
+{
+  // symbols of STRING and IDENTIFIER tokens are already the session's, the
+  // scanner interns into m_strings
+  ++m_live_literals;
+  return m_tokens.literals.add_number(scanned.number(token));
+}
+
+void Session::compact_literals()
+{
+  LiteralTable literals;
+  for (Token &token : m_tokens.tokens)
+  {
+    if (token.type == TokenType::NUMBER)
+    {
+      token.literal = literals.add_number(m_tokens.literals.number(token.literal));
+    }
+  }
+  m_tokens.literals = std::move(literals);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "arena.hpp"
+#include "common.hpp"
+#include "compilation_context.hpp"
+#include "expr.hpp"
+#include "lexer.hpp"
+#include "stats.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct SessionException : LoxException
+{
+  explicit SessionException(const std::string &what) : LoxException(what)
+  {
+  }
+};
+
+/*
+ * Long lived editing session over one buffer, as used by the REPL. Tokens,
+ * the boundaries of the top level expressions, interned strings and the
+ * arena survive from one edit to the next.
+ *
+ * An edit re-lexes from the first token whose scan looked at a changed byte
+ * until the scanner produces a token an old one lines up with, the tokens
+ * after that are only shifted. Parsing restarts at the expression holding
+ * the token before the damage, since that token's successor decided where
+ * it ended, and stops once an expression ends where an old one started.
+ */
+class Session
+{
+public:
+  // called in source order for every top level expression that changed
+  using Handler = std::function<void(Expr &expression, const TokenContext &tokens)>;
+
+  explicit Session(Handler handler);
+
+  Session(const Session &) = delete;
+  Session &operator=(const Session &) = delete;
+
+  // replace length bytes at offset with text, throws SessionException if
+  // the range is not inside the buffer. An edit leaving a string open up to
+  // the end of the buffer is reported and undone.
+  void edit(std::size_t offset, std::size_t length, std::string_view text);
+
+  void append(std::string_view text)
+  {
+    edit(m_source.size(), 0, text);
+  }
+
+  // forget the buffer, the warm state is kept
+  void reset();
+
+  // charge re-lexing and re-parsing of later edits to stats, null stops it
+  void record(Stats *stats)
+  {
+    m_stats = stats;
+  }
+
+  [[nodiscard]] std::string_view source() const
+  {
+    return m_source;
+  }
+
+  [[nodiscard]] std::size_t token_count() const
+  {
+    return m_tokens.tokens.size();
+  }
+
+  [[nodiscard]] std::size_t expression_count() const
+  {
+    return m_expressions.size();
+  }
+
+  StringTable& strings()
+  {
+    return m_strings;
+  }
+
+  Arena& arena()
+  {
+    return m_arena;
+  }
+
+private:
+  // tokens [first, end) of one top level expression
+  struct Expression
+  {
+    std::uint32_t first;
+    std::uint32_t end;
+    std::uint32_t seen; // last token the parser looked at
+    bool failed;        // did not parse, end skips the token the parser stopped at
+  };
+
+  // tokens [first, end) replaced tokens [first, end - delta) of the old list
+  struct Damage
+  {
+    std::size_t first;
+    std::size_t end;
+    std::ptrdiff_t delta;
+  };
+
+  // errors the scanner finds from offset on go to the diagnostics if report
+  // is set, the ones in front of the edit were reported before
+  Damage relex(std::size_t offset, std::size_t length, std::string_view text, bool report);
+  // returns the trees of the expressions which changed, in source order.
+  // The messages of expressions which failed to parse go to failures.
+  std::vector<Expr*> reparse(const Damage &damage, std::vector<std::string> &failures);
+  std::uint32_t adopt_literal(const Token &token, const TokenContext &scanned);
+  void compact_literals();
+
+  Handler m_handler;
+  std::string m_source;
+  TokenList m_tokens;           // always ends with eof, symbols are m_strings'
+  std::size_t m_live_literals{0};
+  std::vector<Expression> m_expressions;
+  StringTable m_strings;
+  CompilationContext m_compilation{m_strings};
+  Arena m_arena;
+  Stats *m_stats{nullptr};
+};
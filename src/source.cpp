@@ -0,0 +1,240 @@
+#include "source.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  // Tokens address the source with 32 bit offsets
+  constexpr std::size_t max_source_size = UINT32_MAX;
+
+  // closes the descriptor when going out of scope
+  struct FdGuard
+  {
+    int fd;
+    ~FdGuard()
+    {
+      ::close(fd);
+    }
+  };
+}
+
+SourceBuffer SourceBuffer::open(const std::string &path)
+{
+  if (path == "-")
+  {
+    return read_fd(STDIN_FILENO);
+  }
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    throw SourceException(std::format("Failed to open file {}: {}", path, std::strerror(errno)));
+  }
+  FdGuard guard{fd};
+
+  struct stat info{};
+  if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+  {
+    return read_fd(fd);
+  }
+  if (static_cast<std::size_t>(info.st_size) > max_source_size)
+  {
+    throw SourceException(std::format("File {} is too large", path));
+  }
+
+  SourceBuffer buffer;
+  if (info.st_size == 0)
+  {
+    // mmap rejects empty mappings, an empty owned string is just as good
+    return buffer;
+  }
+  void *mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapping == MAP_FAILED)
+  {
+    return read_fd(fd);
+  }
+  ::madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+  buffer.m_mapping = static_cast<const char *>(mapping);
+  buffer.m_size = info.st_size;
+  return buffer;
+}
+
+SourceBuffer SourceBuffer::read_fd(int fd)
+{
+  SourceBuffer buffer;
+  std::string &text = buffer.m_storage;
+
+  struct stat info{};
+  if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+  {
+    text.reserve(info.st_size);
+  }
+
+  std::size_t used = 0;
+  while (true)
+  {
+    if (text.size() == used)
+    {
+      text.resize(std::max<std::size_t>(4096, text.size() * 2));
+    }
+    ssize_t count = ::read(fd, text.data() + used, text.size() - used);
+    if (count < 0)
+    {
+      if (errno == EINTR) continue;
+      throw SourceException(std::format("Failed to read input: {}", std::strerror(errno)));
+    }
+    if (count == 0) break;
+    used += count;
+    if (used > max_source_size)
+    {
+      throw SourceException("Input is too large");
+    }
+  }
+  text.resize(used);
+  return buffer;
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer &&other) noexcept
+  : m_mapping(std::exchange(other.m_mapping, nullptr)),
+    m_size(std::exchange(other.m_size, 0)),
+    m_storage(std::move(other.m_storage))
+{
+}
+
+SourceBuffer &SourceBuffer::operator=(SourceBuffer &&other) noexcept
+{
+  if (this != &other)
+  {
+    release();
+    m_mapping = std::exchange(other.m_mapping, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    m_storage = std::move(other.m_storage);
+  }
+  return *this;
+}
+
+SourceBuffer::~SourceBuffer()
+{
+  release();
+}
+
+void SourceBuffer::release()
+{
+  if (m_mapping != nullptr)
+  {
+    ::munmap(const_cast<char *>(m_mapping), m_size);
+    m_mapping = nullptr;
+    m_size = 0;
+  }
+}
+
+BlockReader BlockReader::open(const std::string &path, std::size_t block_size)
+{
+  if (path == "-")
+  {
+    return BlockReader{STDIN_FILENO, false, block_size};
+  }
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    throw SourceException(std::format("Failed to open file {}: {}", path, std::strerror(errno)));
+  }
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  return BlockReader{fd, true, block_size};
+}
+
+BlockReader::BlockReader(int fd, bool owned, std::size_t block_size)
+  : m_fd(fd), m_owned(owned), m_block_size(block_size)
+{
+}
+
+BlockReader::BlockReader(BlockReader &&other) noexcept
+  : m_fd(std::exchange(other.m_fd, -1)),
+    m_owned(std::exchange(other.m_owned, false)),
+    m_block_size(other.m_block_size),
+    m_window(std::move(other.m_window)),
+    m_lines(std::exchange(other.m_lines, 0)),
+    m_exhausted(std::exchange(other.m_exhausted, true)),
+    m_consumed(other.m_consumed),
+    m_origin(other.m_origin)
+{
+}
+
+BlockReader::~BlockReader()
+{
+  if (m_owned)
+  {
+    ::close(m_fd);
+  }
+}
+
+bool BlockReader::fill()
+{
+  if (m_exhausted)
+  {
+    return false;
+  }
+  // Nothing consumed since the last fill means one expression runs through
+  // the whole window. Reading as much again as it holds keeps the number of
+  // times a long expression is scanned again logarithmic in its length.
+  std::size_t wanted = m_consumed ? 1 : m_window.size();
+  m_consumed = false;
+
+  std::size_t start = m_window.size();
+  while (m_window.size() - start < wanted || m_lines <= start)
+  {
+    std::size_t used = m_window.size();
+    m_window.resize(used + m_block_size);
+    ssize_t count = ::read(m_fd, m_window.data() + used, m_block_size);
+    if (count < 0)
+    {
+      m_window.resize(used);
+      if (errno == EINTR) continue;
+      throw SourceException(std::format("Failed to read input: {}", std::strerror(errno)));
+    }
+    m_window.resize(used + count);
+    if (count == 0)
+    {
+      m_exhausted = true;
+      break;
+    }
+    if (m_window.size() > max_source_size)
+    {
+      throw SourceException("Expression is too large");
+    }
+    std::size_t newline = std::string_view(m_window).substr(used).rfind('\n');
+    if (newline != std::string_view::npos)
+    {
+      m_lines = used + newline + 1;
+    }
+  }
+  return true;
+}
+
+void BlockReader::consume(std::size_t count)
+{
+  std::string_view done = std::string_view(m_window).substr(0, count);
+  std::size_t last = done.rfind('\n');
+  if (last == std::string_view::npos)
+  {
+    m_origin.column += static_cast<int>(count);
+  }
+  else
+  {
+    m_origin.line += static_cast<int>(std::count(done.begin(), done.end(), '\n'));
+    m_origin.column = static_cast<int>(count - last - 1);
+  }
+  m_window.erase(0, count);
+  m_lines = m_lines > count ? m_lines - count : 0;
+  m_consumed = m_consumed || count > 0;
+}
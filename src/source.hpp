@@ -0,0 +1,110 @@
+#pragma once
+
+#include "common.hpp"
+#include "source_map.hpp"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+struct SourceException : LoxException
+{
+  explicit SourceException(const std::string &what = "") : LoxException(what)
+  {
+  }
+};
+
+/*
+ * Read-only buffer holding the text of a script. Regular files are memory
+ * mapped so the scanner works directly on the page cache, everything else
+ * (pipes, terminals, stdin) is read once into an owned string.
+ */
+class SourceBuffer
+{
+public:
+  // Map or read the file at path, "-" reads from stdin
+  static SourceBuffer open(const std::string &path);
+
+  // Read everything from an already open descriptor
+  static SourceBuffer read_fd(int fd);
+
+  SourceBuffer() = default;
+  SourceBuffer(const SourceBuffer &) = delete;
+  SourceBuffer &operator=(const SourceBuffer &) = delete;
+  SourceBuffer(SourceBuffer &&other) noexcept;
+  SourceBuffer &operator=(SourceBuffer &&other) noexcept;
+  ~SourceBuffer();
+
+  [[nodiscard]] std::string_view view() const
+  {
+    return m_mapping != nullptr ? std::string_view(m_mapping, m_size) : std::string_view(m_storage);
+  }
+
+  [[nodiscard]] bool is_mapped() const
+  {
+    return m_mapping != nullptr;
+  }
+
+private:
+  void release();
+
+  const char *m_mapping{nullptr};
+  std::size_t m_size{0};
+  std::string m_storage; // used when the input could not be mapped
+};
+
+/*
+ * Reads a script in blocks of a fixed size instead of all at once, for input
+ * too long to hold in memory. The window keeps what was read and not yet
+ * consumed, and only its complete lines are handed out until the input is
+ * exhausted: no token spans a newline except a string literal, so the text
+ * up to the last newline never ends in part of a token that is not a string.
+ */
+class BlockReader
+{
+public:
+  static constexpr std::size_t default_block_size = 64 * 1024;
+
+  // Open the file at path, "-" reads from stdin
+  static BlockReader open(const std::string &path, std::size_t block_size = default_block_size);
+
+  // Read from an already open descriptor, which is closed at the end if owned
+  BlockReader(int fd, bool owned, std::size_t block_size = default_block_size);
+  BlockReader(const BlockReader &) = delete;
+  BlockReader &operator=(const BlockReader &) = delete;
+  BlockReader(BlockReader &&other) noexcept;
+  ~BlockReader();
+
+  // Read blocks until the window holds another complete line or the input
+  // is exhausted, false if it was exhausted before
+  bool fill();
+
+  // Drop the first count bytes of the window, which are done with
+  void consume(std::size_t count);
+
+  // The complete lines of the window, all of it once the input is exhausted
+  [[nodiscard]] std::string_view lines() const
+  {
+    return m_exhausted ? std::string_view(m_window) : std::string_view(m_window).substr(0, m_lines);
+  }
+
+  [[nodiscard]] bool exhausted() const
+  {
+    return m_exhausted;
+  }
+
+  // Line and column of the first byte of the window in the whole input
+  [[nodiscard]] SourcePosition origin() const
+  {
+    return m_origin;
+  }
+
+private:
+  int m_fd;
+  bool m_owned;
+  std::size_t m_block_size;
+  std::string m_window;
+  std::size_t m_lines{0};    // end of the last complete line in the window
+  bool m_exhausted{false};
+  bool m_consumed{true};     // something was consumed since the last fill
+  SourcePosition m_origin{0, 0};
+};
@@ -0,0 +1,23 @@
+#include "source_map.hpp"
+
+#include <algorithm>
+#include "scan_kernels.hpp"
+
+SourcePosition SourceMap::position(std::size_t offset) const
+{
+  if (m_line_starts.empty())
+  {
+    const ScanKernels &kernels = ScanKernels::best();
+    m_line_starts.push_back(0);
+    for (std::size_t newline = kernels.find_newline(m_source.data(), m_source.size(), 0); newline < m_source.size();
+         newline = kernels.find_newline(m_source.data(), m_source.size(), newline + 1))
+    {
+      m_line_starts.push_back(static_cast<std::uint32_t>(newline + 1));
+    }
+  }
+  auto next = std::upper_bound(m_line_starts.begin(), m_line_starts.end(), offset);
+  auto line = static_cast<int>(next - m_line_starts.begin() - 1);
+  auto column = static_cast<int>(offset - m_line_starts[line]);
+  // only the first line starts in the middle of one of the input
+  return SourcePosition{m_origin.line + line, line == 0 ? m_origin.column + column : column};
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/*
+ * Line and column of a byte in a source, both counted from 0
+ */
+struct SourcePosition
+{
+  int line;
+  int column;
+};
+
+/*
+ * Turns byte offsets into line and column. Tokens and diagnostics only carry
+ * offsets, the table of line starts is built the first time a position is
+ * asked for, so a source which never reports anything is never searched for
+ * newlines. The map looks at the source, it must outlive the lookups.
+ */
+class SourceMap
+{
+public:
+  SourceMap() = default;
+
+  explicit SourceMap(std::string_view source) : m_source(source)
+  {
+  }
+
+  // the source changed or moved, positions are worked out afresh. origin is
+  // where source[0] sits when source is only a piece of a longer input.
+  void reset(std::string_view source, SourcePosition origin = {0, 0})
+  {
+    m_source = source;
+    m_origin = origin;
+    m_line_starts.clear();
+  }
+
+  [[nodiscard]] SourcePosition position(std::size_t offset) const;
+
+private:
+  std::string_view m_source;
+  SourcePosition m_origin{0, 0};
+  mutable std::vector<std::uint32_t> m_line_starts; // sorted, empty until the first lookup
+};
@@ -0,0 +1,102 @@
+#include "stats.hpp"
+
+#include <format>
+#include <string>
+#include <sys/resource.h>
+
+namespace
+{
+  std::int64_t nanoseconds(std::chrono::steady_clock::duration duration)
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  }
+
+  // high water mark of the resident set, ru_maxrss is in KiB on Linux
+  long peak_rss_kib()
+  {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+      return -1;
+    }
+    return usage.ru_maxrss;
+  }
+
+  std::string allocation_fields(const alloc_stats::Snapshot &allocated)
+  {
+    if (!alloc_stats::counting())
+    {
+      return "";
+    }
+    return std::format(",\"allocations\":{},\"allocated_bytes\":{}", allocated.allocations, allocated.bytes);
+  }
+}
+
+const char* to_string(Stats::Phase phase)
+{
+  switch (phase)
+  {
+    case Stats::Phase::Idle: return "idle";
+    case Stats::Phase::Read: return "read";
+    case Stats::Phase::Cache: return "cache";
+    case Stats::Phase::Scan: return "scan";
+    case Stats::Phase::Parse: return "parse";
+    case Stats::Phase::Optimize: return "optimize";
+    case Stats::Phase::Print: return "print";
+    case Stats::Phase::Eval: return "eval";
+  }
+  return "unknown";
+}
+
+Stats::Stats()
+  : m_since(std::chrono::steady_clock::now()), m_allocated_since(alloc_stats::snapshot()), m_start(m_since)
+{
+}
+
+Stats::Phase Stats::enter(Phase phase)
+{
+  auto now = std::chrono::steady_clock::now();
+  auto allocated = alloc_stats::snapshot();
+
+  auto &totals = m_phases[static_cast<std::size_t>(m_current)];
+  totals.wall += now - m_since;
+  totals.allocated.allocations += allocated.allocations - m_allocated_since.allocations;
+  totals.allocated.bytes += allocated.bytes - m_allocated_since.bytes;
+  m_phases[static_cast<std::size_t>(phase)].entered = true;
+
+  m_since = now;
+  m_allocated_since = allocated;
+  Phase previous = m_current;
+  m_current = phase;
+  return previous;
+}
+
+void Stats::report(std::ostream &out)
+{
+  // close the books on whatever is running so the totals add up
+  enter(m_current);
+
+  alloc_stats::Snapshot allocated;
+  for (std::size_t i{1}; i < phase_count; ++i)
+  {
+    const auto &totals = m_phases[i];
+    if (!totals.entered)
+    {
+      continue;
+    }
+    allocated.allocations += totals.allocated.allocations;
+    allocated.bytes += totals.allocated.bytes;
+    out << std::format("{{\"type\":\"phase\",\"phase\":\"{}\",\"wall_ns\":{}{}}}\n", to_string(static_cast<Phase>(i)),
+                       nanoseconds(totals.wall), allocation_fields(totals.allocated));
+  }
+  if (m_shared_requested > 0)
+  {
+    out << std::format("{{\"type\":\"hash_cons\",\"nodes\":{},\"unique_nodes\":{},\"dedup_ratio\":{:.2f}}}\n",
+                       m_shared_requested, m_shared_unique,
+                       static_cast<double>(m_shared_requested) / static_cast<double>(m_shared_unique));
+  }
+  out << std::format("{{\"type\":\"total\",\"wall_ns\":{},\"source_bytes\":{},\"tokens\":{},\"nodes\":{},"
+                     "\"peak_rss_kib\":{}{}}}\n",
+                     nanoseconds(std::chrono::steady_clock::now() - m_start), m_source_bytes, m_tokens, m_nodes,
+                     peak_rss_kib(), allocation_fields(allocated));
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "alloc_stats.hpp"
+#include "lexer.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/*
+ * Time and allocations spent per phase of a run. Exactly one phase is
+ * current at any time and everything that happens is charged to it, so
+ * the scanner work done while the parser pulls tokens counts as scanning,
+ * not parsing.
+ */
+class Stats
+{
+public:
+  enum class Phase : std::uint8_t
+  {
+    Idle,
+    Read,
+    Cache,
+    Scan,
+    Parse,
+    Optimize,
+    Print,
+    Eval,
+  };
+
+  static constexpr std::size_t phase_count = static_cast<std::size_t>(Phase::Eval) + 1;
+
+  /*
+   * Makes phase current for the lifetime of the scope and restores the
+   * previous one afterwards. A null Stats makes the scope a no-op.
+   */
+  class Scope
+  {
+  public:
+    Scope(Stats *stats, Phase phase) : m_stats(stats)
+    {
+      if (m_stats != nullptr)
+      {
+        m_previous = m_stats->enter(phase);
+      }
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+    ~Scope()
+    {
+      if (m_stats != nullptr)
+      {
+        m_stats->enter(m_previous);
+      }
+    }
+
+  private:
+    Stats *m_stats;
+    Phase m_previous{Phase::Idle};
+  };
+
+  Stats();
+
+  void add_tokens(std::size_t count)
+  {
+    m_tokens += count;
+  }
+
+  void add_nodes(std::size_t count)
+  {
+    m_nodes += count;
+  }
+
+  void add_source_bytes(std::size_t count)
+  {
+    m_source_bytes += count;
+  }
+
+  // nodes the parser asked a HashCons for and how many of them it allocated
+  void add_shared_nodes(std::size_t requested, std::size_t unique)
+  {
+    m_shared_requested += requested;
+    m_shared_unique += unique;
+  }
+
+  // write one JSON object per phase that was entered, one on hash consing if
+  // it was used and one with the totals
+  void report(std::ostream &out);
+
+private:
+  struct PhaseTotals
+  {
+    std::chrono::steady_clock::duration wall{};
+    alloc_stats::Snapshot allocated;
+    bool entered{false};
+  };
+
+  // charge everything since the last switch to the current phase
+  Phase enter(Phase phase);
+
+  std::array<PhaseTotals, phase_count> m_phases;
+  Phase m_current{Phase::Idle};
+  std::chrono::steady_clock::time_point m_since;
+  alloc_stats::Snapshot m_allocated_since;
+  std::chrono::steady_clock::time_point m_start;
+  std::size_t m_tokens{0};
+  std::size_t m_nodes{0};
+  std::size_t m_source_bytes{0};
+  std::size_t m_shared_requested{0};
+  std::size_t m_shared_unique{0};
+};
+
+const char* to_string(Stats::Phase phase);
+
+/*
+ * Counts the tokens handed out by another stream and charges the time spent
+ * producing them to the scan phase.
+ */
+class StatsTokenStream : public TokenStream
+{
+public:
+  StatsTokenStream(TokenStream &tokens, Stats &stats) : m_tokens(tokens), m_stats(stats)
+  {
+  }
+
+  Token next() override
+  {
+    Stats::Scope scope{&m_stats, Stats::Phase::Scan};
+    m_stats.add_tokens(1);
+    return m_tokens.next();
+  }
+
+  const TokenContext& context() const override
+  {
+    return m_tokens.context();
+  }
+
+  void release_before(const Token &token) override
+  {
+    m_tokens.release_before(token);
+  }
+
+private:
+  TokenStream &m_tokens;
+  Stats &m_stats;
+};
@@ -0,0 +1,107 @@
+#include "compilation_context.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <future>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+/*
+ * Scanners and parsers only report to the CompilationContext they are given,
+ * so sources parsed on different threads at once must each end up with their
+ * own diagnostics and nothing else.
+ */
+namespace
+{
+  struct Reported
+  {
+    std::size_t offset;
+    std::string where;
+    std::string message;
+    std::size_t error_count;
+
+    bool operator==(const Reported &other) const = default;
+  };
+
+  // source number index, every third one with a scan error and a parse error
+  // whose lexeme only appears in this source
+  std::string make_source(std::size_t index)
+  {
+    std::string number = std::to_string(index);
+    std::string source;
+    for (std::size_t line{0}; line < 50 + index % 17; ++line)
+    {
+      source += "(" + number + " + " + std::to_string(line) + ") * -" + number + " == !true\n";
+    }
+    if (index % 3 == 0)
+    {
+      source += std::string(index % 5, ' ') + "@ " + number + " + (" + number + " " + number + "\n";
+    }
+    return source;
+  }
+
+  // parse every expression like a script, stopping at the first one which fails
+  std::vector<Reported> parse(const std::string &source)
+  {
+    StringTable strings;
+    CompilationContext compilation{strings};
+    Scanner scanner{source, compilation};
+    Parser parser{scanner, compilation};
+    while (!parser.is_at_end() && parser.parse() != nullptr)
+    {
+      parser.release();
+    }
+
+    std::vector<Reported> reported;
+    for (const Diagnostic &diagnostic : compilation.diagnostics().pending())
+    {
+      reported.push_back(Reported{diagnostic.offset, diagnostic.where, diagnostic.message,
+                                  compilation.diagnostics().error_count()});
+    }
+    return reported;
+  }
+}
+
+TEST(CompilationContext, DiagnosticsStayWithTheirSource)
+{
+  constexpr std::size_t source_count = 600;
+  std::vector<std::string> sources;
+  std::vector<std::vector<Reported>> expected;
+  for (std::size_t index{0}; index < source_count; ++index)
+  {
+    sources.push_back(make_source(index));
+    expected.push_back(parse(sources.back()));
+  }
+
+  ThreadPool pool{8};
+  for (int round{0}; round < 5; ++round)
+  {
+    std::vector<std::future<std::vector<Reported>>> parsed;
+    for (const std::string &source : sources)
+    {
+      parsed.push_back(pool.submit([&source] { return parse(source); }));
+    }
+    for (std::size_t index{0}; index < source_count; ++index)
+    {
+      SCOPED_TRACE("source " + std::to_string(index));
+      std::vector<Reported> reported = parsed[index].get();
+      EXPECT_EQ(reported.size(), index % 3 == 0 ? 2u : 0u);
+      EXPECT_EQ(reported, expected[index]);
+      for (const Reported &error : reported)
+      {
+        // the offset is inside this source and the lexeme an error names is
+        // the one found there
+        ASSERT_LT(error.offset, sources[index].size());
+        if (!error.where.empty())
+        {
+          std::string number = std::to_string(index);
+          EXPECT_EQ(error.where, " at '" + number + "'");
+          EXPECT_EQ(sources[index].compare(error.offset, number.size(), number), 0);
+        }
+      }
+    }
+  }
+}
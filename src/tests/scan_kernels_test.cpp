@@ -0,0 +1,298 @@
+#include "compilation_context.hpp"
+#include "lexer.hpp"
+#include "scan_kernels.hpp"
+#include "value.hpp"
+#include <charconv>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * The SIMD kernels must not change what the scanner produces. Every kernel
+ * set is compared against plain loops, and the tokens and diagnostics of a
+ * Scanner using it against the byte-at-a-time scanner the kernels replaced,
+ * which is kept here as the reference.
+ */
+namespace
+{
+  constexpr ScanKernels::Isa all_isas[] = {ScanKernels::Isa::Scalar, ScanKernels::Isa::SSE2, ScanKernels::Isa::AVX2};
+
+  bool is_digit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  bool is_alpha(char c)
+  {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+  }
+
+  std::string number_text(double value)
+  {
+    char digits[32];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+    return std::string(digits, end);
+  }
+
+  std::string token_line(TokenType type, std::size_t offset, std::size_t length, std::string_view value)
+  {
+    return to_string(type) + " " + std::to_string(offset) + " " + std::to_string(length) + " " + std::string(value);
+  }
+
+  std::string diagnostic_line(std::size_t offset, std::string_view message)
+  {
+    return "error " + std::to_string(offset) + " " + std::string(message);
+  }
+
+  // the scanner before the kernels, one byte at a time
+  std::vector<std::string> reference_scan(std::string_view source)
+  {
+    std::vector<std::string> dump;
+    std::size_t start{0};
+    std::size_t current{0};
+    auto at_end = [&] { return current >= source.size(); };
+    auto peek = [&] { return at_end() ? '\0' : source[current]; };
+    auto peek_next = [&] { return current + 1 >= source.size() ? '\0' : source[current + 1]; };
+    auto match = [&](char expected) {
+      if (at_end() || source[current] != expected) return false;
+      ++current;
+      return true;
+    };
+    auto add = [&](TokenType type) { dump.push_back(token_line(type, start, current - start, "")); };
+
+    while (!at_end())
+    {
+      char c = source[current++];
+      switch (c)
+      {
+        case '(': add(TokenType::LEFT_PAREN); break;
+        case ')': add(TokenType::RIGHT_PAREN); break;
+        case '{': add(TokenType::LEFT_BRACE); break;
+        case '}': add(TokenType::RIGHT_BRACE); break;
+        case ',': add(TokenType::COMMA); break;
+        case '.': add(TokenType::DOT); break;
+        case '-': add(TokenType::MINUS); break;
+        case '+': add(TokenType::PLUS); break;
+        case ';': add(TokenType::SEMICOLON); break;
+        case '*': add(TokenType::STAR); break;
+        case '!': add(match('=') ? TokenType::BANG_EQUAL : TokenType::BANG); break;
+        case '=': add(match('=') ? TokenType::EQAUL_EQUAL : TokenType::EQUAL); break;
+        case '<': add(match('=') ? TokenType::LESS_EQUAL : TokenType::LESS); break;
+        case '>': add(match('=') ? TokenType::GREATER_EQUAL : TokenType::GREATER); break;
+        case '/':
+          if (match('/'))
+          {
+            while (peek() != '\n' && !at_end()) ++current;
+          }
+          else
+          {
+            add(TokenType::SLASH);
+          }
+          break;
+        case '"':
+          while (peek() != '"' && !at_end()) ++current;
+          if (at_end())
+          {
+            dump.push_back(diagnostic_line(current, "Unterminated String"));
+            continue;
+          }
+          ++current;
+          dump.push_back(token_line(TokenType::STRING, start + 1, current - start - 2,
+                                    source.substr(start + 1, current - start - 2)));
+          break;
+        case ' ':
+        case '\r':
+        case '\t':
+        case '\n':
+          break;
+        default:
+          if (is_digit(c))
+          {
+            while (is_digit(peek())) ++current;
+            if (peek() == '.' && is_digit(peek_next()))
+            {
+              ++current;
+              while (is_digit(peek())) ++current;
+            }
+            double value{0};
+            std::from_chars(source.data() + start, source.data() + current, value);
+            dump.push_back(token_line(TokenType::NUMBER, start, current - start, number_text(value)));
+          }
+          else if (is_alpha(c))
+          {
+            while (is_alpha(peek()) || is_digit(peek())) ++current;
+            std::string_view text = source.substr(start, current - start);
+            TokenType type = keyword_type(text);
+            dump.push_back(token_line(type, start, current - start, type == TokenType::IDENTIFIER ? text : ""));
+          }
+          else
+          {
+            dump.push_back(diagnostic_line(start, "Unexpected character"));
+          }
+          break;
+      }
+      start = current;
+    }
+    dump.push_back(token_line(TokenType::eof, start, current - start, ""));
+    return dump;
+  }
+
+  // the same dump from the Scanner, with errors in the order they were found
+  std::vector<std::string> scan(std::string_view source, const ScanKernels &kernels)
+  {
+    StringTable strings;
+    CompilationContext compilation{strings};
+    Scanner scanner{source, compilation, kernels};
+    std::vector<std::string> dump;
+    std::size_t reported{0};
+    while (true)
+    {
+      Token token = scanner.next();
+      const std::vector<Diagnostic> &pending = compilation.diagnostics().pending();
+      for (; reported < pending.size(); ++reported)
+      {
+        dump.push_back(diagnostic_line(pending[reported].offset, pending[reported].message));
+      }
+      std::string value;
+      if (token.type == TokenType::NUMBER)
+      {
+        value = number_text(scanner.context().number(token));
+      }
+      else if (token.type == TokenType::STRING || token.type == TokenType::IDENTIFIER)
+      {
+        value = scanner.context().string(token);
+      }
+      dump.push_back(token_line(token.type, token.offset, token.length, value));
+      if (token.type == TokenType::eof)
+      {
+        return dump;
+      }
+    }
+  }
+
+  // short inputs around the edges of the kernels
+  std::vector<std::string> edge_cases()
+  {
+    std::vector<std::string> sources = {
+      "",
+      "\"abc",
+      "\"",
+      "1 + \"unterminated\nover lines",
+      "// comment at the end",
+      "//",
+      "1 // comment\n2 //",
+      "/",
+      "\"\"",
+      "\r\t \n\r\n",
+      "12.5 .5 5. 1.2.3",
+      "and class else false for fun if nil or print return super this true var while",
+      "andy _a1 a_ __ x9",
+      "caf\xc3\xa9 \xff \x80",
+      "\"na\xc3\xafve \xe2\x82\xac\" // \xf0\x9f\x98\x80 comment\n\xc3\xa9",
+      "ab\xc3\xa9" "cd",
+      "!= == <= >= ! = < > ( ) { } , . - + ; * / @ # $",
+    };
+
+    // runs of every length up to and across two 32 byte blocks, starting on
+    // either side of the 16 and 32 byte edges
+    for (std::size_t length{0}; length <= 70; ++length)
+    {
+      for (std::size_t lead : {0, 1, 15, 16, 17, 31, 32, 33})
+      {
+        std::string pad(lead, ' ');
+        sources.push_back(pad + std::string(length, ' ') + "1");
+        sources.push_back(pad + std::string(length, '\n') + "x");
+        sources.push_back(pad + std::string(length, '\t') + std::string(length % 3, '\r') + "\"s\"");
+        sources.push_back(pad + "x" + std::string(length, 'a') + " y");
+        sources.push_back(pad + "x" + std::string(length, 'Z') + "\xc3\xa9");
+        sources.push_back(pad + "\"" + std::string(length, 'q') + "\" 1");
+        sources.push_back(pad + "\"" + std::string(length, '\n') + "\"");
+        sources.push_back(pad + "\"" + std::string(length, 'q'));
+        sources.push_back(pad + "//" + std::string(length, '/') + "\n2");
+        sources.push_back(pad + "//" + std::string(length, 'c'));
+      }
+    }
+    return sources;
+  }
+
+  // longer inputs from every kind of lexeme, including bytes outside ASCII
+  std::vector<std::string> random_sources()
+  {
+    const std::vector<std::string> pieces = {
+      "1", "23.75", "x", "identifier_long_enough_to_span_a_block", "and", "\"s\"", "\"multi\nline\"",
+      "\"a longer string literal that crosses one vector width\"", "// c\n", "//", "+", "-", "==", "!", "(", ")",
+      " ", "    ", "\t", "\r\n", "\n", "                                  ", "@", "\xc3\xa9", "\xff", "\"",
+    };
+    std::mt19937 random{20};
+    std::vector<std::string> sources;
+    for (int i{0}; i < 500; ++i)
+    {
+      std::string source;
+      std::size_t count = random() % 80;
+      for (std::size_t piece{0}; piece < count; ++piece)
+      {
+        source += pieces[random() % pieces.size()];
+      }
+      sources.push_back(std::move(source));
+    }
+    return sources;
+  }
+}
+
+TEST(ScanKernels, MatchPlainLoopsAtEveryPosition)
+{
+  auto is_space = [](char c) { return c == ' ' || c == '\r' || c == '\t' || c == '\n'; };
+  auto is_word = [](char c) { return is_alpha(c) || is_digit(c); };
+  auto run_end = [](std::string_view source, std::size_t pos, auto in_run) {
+    while (pos < source.size() && in_run(source[pos])) ++pos;
+    return pos;
+  };
+
+  std::vector<std::string> sources = edge_cases();
+  std::vector<std::string> more = random_sources();
+  sources.insert(sources.end(), more.begin(), more.end());
+  for (ScanKernels::Isa isa : all_isas)
+  {
+    const ScanKernels &kernels = ScanKernels::get(isa);
+    for (const std::string &source : sources)
+    {
+      for (std::size_t pos{0}; pos <= source.size(); ++pos)
+      {
+        SCOPED_TRACE(std::string(to_string(isa)) + " at " + std::to_string(pos) + " of \"" + source + "\"");
+        EXPECT_EQ(kernels.skip_whitespace(source.data(), source.size(), pos), run_end(source, pos, is_space));
+        EXPECT_EQ(kernels.find_newline(source.data(), source.size(), pos),
+                  run_end(source, pos, [](char c) { return c != '\n'; }));
+        EXPECT_EQ(kernels.find_quote(source.data(), source.size(), pos),
+                  run_end(source, pos, [](char c) { return c != '"'; }));
+        EXPECT_EQ(kernels.skip_identifier(source.data(), source.size(), pos), run_end(source, pos, is_word));
+      }
+    }
+  }
+}
+
+TEST(ScanKernels, ScannerMatchesReferenceOnEdgeCases)
+{
+  for (ScanKernels::Isa isa : all_isas)
+  {
+    for (const std::string &source : edge_cases())
+    {
+      SCOPED_TRACE(std::string(to_string(isa)) + " on \"" + source + "\"");
+      EXPECT_EQ(scan(source, ScanKernels::get(isa)), reference_scan(source));
+    }
+  }
+}
+
+TEST(ScanKernels, ScannerMatchesReferenceOnRandomSources)
+{
+  for (ScanKernels::Isa isa : all_isas)
+  {
+    for (const std::string &source : random_sources())
+    {
+      SCOPED_TRACE(std::string(to_string(isa)) + " on \"" + source + "\"");
+      EXPECT_EQ(scan(source, ScanKernels::get(isa)), reference_scan(source));
+    }
+  }
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Fixed set of worker threads with a task queue each. Tasks submitted by a
+ * worker go to its own queue, others are dealt out round robin. A worker
+ * runs its own queue in FIFO order and steals from the back of the others'
+ * once it runs dry, so uneven tasks still keep every thread busy.
+ */
+class ThreadPool
+{
+public:
+  // thread_count 0 uses one thread per hardware thread
+  explicit ThreadPool(std::size_t thread_count = 0)
+  {
+    if (thread_count == 0)
+    {
+      thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_queues.reserve(thread_count);
+    for (std::size_t i{0}; i < thread_count; ++i)
+    {
+      m_queues.push_back(std::make_unique<Queue>());
+    }
+    m_workers.reserve(thread_count);
+    for (std::size_t i{0}; i < thread_count; ++i)
+    {
+      m_workers.emplace_back([this, i] { work(i); });
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard lock{m_mutex};
+      m_stopping = true;
+    }
+    m_wakeup.notify_all();
+    for (auto &worker : m_workers)
+    {
+      worker.join();
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const
+  {
+    return m_workers.size();
+  }
+
+  // run task on a worker, the future carries its result or exception
+  template<typename F>
+  auto submit(F &&task) -> std::future<std::invoke_result_t<F>>
+  {
+    using Result = std::invoke_result_t<F>;
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    auto future = packaged->get_future();
+    std::size_t index = current_worker.pool == this ? current_worker.index : m_next_queue++ % m_queues.size();
+    {
+      // counted first, a worker woken for it may look before it is queued
+      // but never takes it before it is counted
+      std::lock_guard lock{m_mutex};
+      ++m_pending;
+    }
+    {
+      Queue &queue = *m_queues[index];
+      std::lock_guard lock{queue.mutex};
+      queue.tasks.emplace_back([packaged] { (*packaged)(); });
+    }
+    m_wakeup.notify_one();
+    return future;
+  }
+
+  // call body(i) for every i in [0, count) and wait for all of them
+  template<typename F>
+  void parallel_for(std::size_t count, F &&body)
+  {
+    std::vector<std::future<void>> done;
+    done.reserve(count);
+    for (std::size_t i{0}; i < count; ++i)
+    {
+      done.push_back(submit([&body, i] { body(i); }));
+    }
+    // wait for everything before rethrowing, the tasks reference body
+    for (auto &future : done)
+    {
+      future.wait();
+    }
+    for (auto &future : done)
+    {
+      future.get();
+    }
+  }
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  // the pool and queue of the worker running on this thread
+  struct Worker
+  {
+    ThreadPool *pool;
+    std::size_t index;
+  };
+  static inline thread_local Worker current_worker{nullptr, 0};
+
+  void work(std::size_t index)
+  {
+    current_worker = Worker{this, index};
+    while (true)
+    {
+      std::function<void()> task;
+      if (take(index, task))
+      {
+        task();
+        continue;
+      }
+      std::unique_lock lock{m_mutex};
+      m_wakeup.wait(lock, [this] { return m_stopping || m_pending > 0; });
+      if (m_pending == 0)
+      {
+        return;
+      }
+    }
+  }
+
+  // pop the front of the worker's own queue or steal the back of another
+  bool take(std::size_t index, std::function<void()> &task)
+  {
+    for (std::size_t i{0}; i < m_queues.size(); ++i)
+    {
+      Queue &queue = *m_queues[(index + i) % m_queues.size()];
+      {
+        std::lock_guard lock{queue.mutex};
+        if (queue.tasks.empty())
+        {
+          continue;
+        }
+        if (i == 0)
+        {
+          task = std::move(queue.tasks.front());
+          queue.tasks.pop_front();
+        }
+        else
+        {
+          task = std::move(queue.tasks.back());
+          queue.tasks.pop_back();
+        }
+      }
+      std::lock_guard lock{m_mutex};
+      --m_pending;
+      return true;
+    }
+    return false;
+  }
+
+  std::vector<std::unique_ptr<Queue>> m_queues; // one per worker
+  std::vector<std::thread> m_workers;
+  std::atomic<std::size_t> m_next_queue{0};
+  std::mutex m_mutex;
+  std::condition_variable m_wakeup;
+  std::size_t m_pending{0}; // tasks submitted and not taken yet
+  bool m_stopping{false};
+};
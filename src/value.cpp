@@ -0,0 +1,88 @@
+#include "value.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <sstream>
+
+namespace
+{
+  // longest shortest round trip form of a double, "-2.2250738585072014e-308"
+  constexpr std::size_t max_number_length = 32;
+}
+
+StringTable::StringTable() : m_text(16 * 1024), m_slots(64, empty_slot)
+{
+}
+
+Symbol StringTable::intern(std::string_view text)
+{
+  std::size_t hash = std::hash<std::string_view>{}(text);
+  std::size_t mask = m_slots.size() - 1;
+  for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask)
+  {
+    Symbol symbol = m_slots[slot];
+    if (symbol == empty_slot)
+    {
+      char *copy = static_cast<char *>(m_text.allocate(text.size(), 1));
+      std::memcpy(copy, text.data(), text.size());
+      symbol = static_cast<Symbol>(m_entries.size());
+      m_entries.push_back(Entry{std::string_view(copy, text.size()), hash});
+      m_slots[slot] = symbol;
+      // keep at least half of the slots free so probe sequences stay short
+      if (m_entries.size() * 2 > m_slots.size())
+      {
+        grow();
+      }
+      return symbol;
+    }
+    if (m_entries[symbol].hash == hash && m_entries[symbol].text == text)
+    {
+      return symbol;
+    }
+  }
+}
+
+void StringTable::grow()
+{
+  std::vector<Symbol> slots(m_slots.size() * 2, empty_slot);
+  std::size_t mask = slots.size() - 1;
+  for (Symbol symbol{0}; symbol < m_entries.size(); ++symbol)
+  {
+    std::size_t slot = m_entries[symbol].hash & mask;
+    while (slots[slot] != empty_slot)
+    {
+      slot = (slot + 1) & mask;
+    }
+    slots[slot] = symbol;
+  }
+  m_slots = std::move(slots);
+}
+
+std::string to_string(const Value &value, const StringTable &strings)
+{
+  std::stringbuf out;
+  write_value(out, value, strings);
+  return std::move(out).str();
+}
+
+void write_value(std::streambuf &out, const Value &value, const StringTable &strings)
+{
+  switch (value.type)
+  {
+    case Value::Type::Nil: out.sputn("nil", 3); break;
+    case Value::Type::Bool: value.as.boolean ? out.sputn("true", 4) : out.sputn("false", 5); break;
+    case Value::Type::Number: write_number(out, value.as.number); break;
+    case Value::Type::String: {
+      std::string_view text = strings.view(value.as.string);
+      out.sputn(text.data(), static_cast<std::streamsize>(text.size()));
+    } break;
+  }
+}
+
+void write_number(std::streambuf &out, double number)
+{
+  char digits[max_number_length];
+  auto [end, error] = std::to_chars(digits, digits + sizeof(digits), number);
+  out.sputn(digits, end - digits);
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "arena.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Number of a string in the StringTable it was interned into
+using Symbol = std::uint32_t;
+
+/*
+ * Owns one copy of every distinct string, kept in an arena, and names it by a
+ * Symbol. Equal strings get the same symbol, so interned strings compare by
+ * number. Lookup is open addressing with linear probing over a power of two
+ * sized array of symbols. Views returned stay valid as long as the table.
+ */
+class StringTable
+{
+public:
+  StringTable();
+
+  StringTable(const StringTable &) = delete;
+  StringTable &operator=(const StringTable &) = delete;
+  StringTable(StringTable &&) noexcept = default;
+  StringTable &operator=(StringTable &&) noexcept = default;
+
+  Symbol intern(std::string_view text);
+
+  [[nodiscard]] std::string_view view(Symbol symbol) const
+  {
+    return m_entries[symbol].text;
+  }
+
+  [[nodiscard]] std::size_t size() const
+  {
+    return m_entries.size();
+  }
+
+private:
+  static constexpr Symbol empty_slot = UINT32_MAX;
+
+  struct Entry
+  {
+    std::string_view text;
+    std::size_t hash;
+  };
+
+  void grow();
+
+  Arena m_text;
+  std::vector<Entry> m_entries; // indexed by Symbol
+  std::vector<Symbol> m_slots;
+};
+
+/*
+ * Runtime value of a Lox expression: a tag and an unboxed payload
+ */
+struct Value
+{
+  enum class Type : std::uint8_t
+  {
+    Nil,
+    Bool,
+    Number,
+    String,
+  };
+
+  Type type;
+  union
+  {
+    bool boolean;
+    double number;
+    Symbol string; // interned
+  } as;
+
+  static Value nil()
+  {
+    return Value{Type::Nil, {.number = 0}};
+  }
+
+  static Value boolean(bool value)
+  {
+    return Value{Type::Bool, {.boolean = value}};
+  }
+
+  static Value number(double value)
+  {
+    return Value{Type::Number, {.number = value}};
+  }
+
+  static Value string(Symbol value)
+  {
+    return Value{Type::String, {.string = value}};
+  }
+
+  [[nodiscard]] bool is_number() const
+  {
+    return type == Type::Number;
+  }
+
+  [[nodiscard]] bool is_string() const
+  {
+    return type == Type::String;
+  }
+
+  // nil and false are falsey, everything else is truthy
+  [[nodiscard]] bool is_truthy() const
+  {
+    switch (type)
+    {
+      case Type::Nil: return false;
+      case Type::Bool: return as.boolean;
+      default: return true;
+    }
+  }
+
+  friend bool operator==(const Value &left, const Value &right)
+  {
+    if (left.type != right.type)
+    {
+      return false;
+    }
+    switch (left.type)
+    {
+      case Type::Nil: return true;
+      case Type::Bool: return left.as.boolean == right.as.boolean;
+      case Type::Number: return left.as.number == right.as.number;
+      case Type::String: return left.as.string == right.as.string;
+    }
+    return false;
+  }
+};
+
+// format a value the way Lox prints it, strings are looked up in strings
+std::string to_string(const Value &value, const StringTable &strings);
+
+// write a value the way Lox prints it, without building a string first
+void write_value(std::streambuf &out, const Value &value, const StringTable &strings);
+
+// write number in the shortest form that reads back as the same double
+void write_number(std::streambuf &out, double number);
@@ -0,0 +1,206 @@
+#include "vm.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+
+// gcc and clang can jump through a table of label addresses, which gives
+// every instruction its own indirect branch instead of one shared switch
+#if defined(__GNUC__)
+#define LOX_COMPUTED_GOTO 1
+#else
+#define LOX_COMPUTED_GOTO 0
+#endif
+
+void VM::interpret(const Chunk &chunk, const SourceMap &source_map)
+{
+  try
+  {
+    Value value = run(chunk).to_value();
+    write_value(*Output::results->rdbuf(), value, m_strings);
+    Output::results->rdbuf()->sputc('\n');
+  }
+  catch (const VmError &error)
+  {
+    runtime_error(source_map.position(error.source), error.what());
+  }
+}
+
+NanValue VM::run(const Chunk &chunk)
+{
+  // the compiler worked out how deep the stack gets, so pushes are unchecked
+  if (m_stack.size() < chunk.max_stack)
+  {
+    m_stack.resize(chunk.max_stack, NanValue::nil());
+  }
+
+  const std::uint8_t *ip = chunk.code.data();
+  const NanValue *constants = chunk.constants.data();
+  NanValue *top = m_stack.data();
+
+  auto fail = [&](const char *message) -> VmError {
+    return VmError(chunk.source_at(static_cast<std::size_t>(ip - chunk.code.data() - 1)), message);
+  };
+
+#define PUSH(value) (*top++ = (value))
+#define POP() (*--top)
+#define PEEK(distance) (top[-1 - (distance)])
+#define NUMBER_OPERANDS()                                                                                              \
+  if (!PEEK(0).is_number() || !PEEK(1).is_number()) throw fail("Operands must be numbers.");                           \
+  double right = POP().as_number();                                                                                    \
+  double left = POP().as_number()
+
+#if LOX_COMPUTED_GOTO
+  static void *const dispatch_table[] = {
+    &&op_CONSTANT, &&op_CONSTANT_LONG, &&op_NIL,     &&op_TRUE,     &&op_FALSE,    &&op_EQUAL,
+    &&op_NOT_EQUAL, &&op_GREATER,      &&op_GREATER_EQUAL, &&op_LESS, &&op_LESS_EQUAL, &&op_ADD,
+    &&op_SUBTRACT, &&op_MULTIPLY,      &&op_DIVIDE,  &&op_NOT,      &&op_NEGATE,   &&op_RETURN,
+  };
+  static_assert(std::size(dispatch_table) == opcode_count);
+#define DISPATCH() goto *dispatch_table[*ip++]
+#define CASE(op) op_##op
+#else
+#define DISPATCH() continue
+#define CASE(op) case OpCode::op
+#endif
+
+#if LOX_COMPUTED_GOTO
+  DISPATCH();
+#else
+  for (;;)
+  {
+    switch (static_cast<OpCode>(*ip++))
+#endif
+    {
+      CASE(CONSTANT) :
+      {
+        PUSH(constants[*ip++]);
+        DISPATCH();
+      }
+      CASE(CONSTANT_LONG) :
+      {
+        std::uint32_t index = ip[0] | (ip[1] << 8) | (ip[2] << 16);
+        ip += 3;
+        PUSH(constants[index]);
+        DISPATCH();
+      }
+      CASE(NIL) :
+      {
+        PUSH(NanValue::nil());
+        DISPATCH();
+      }
+      CASE(TRUE) :
+      {
+        PUSH(NanValue::boolean(true));
+        DISPATCH();
+      }
+      CASE(FALSE) :
+      {
+        PUSH(NanValue::boolean(false));
+        DISPATCH();
+      }
+      CASE(EQUAL) :
+      {
+        NanValue right = POP();
+        NanValue left = POP();
+        PUSH(NanValue::boolean(left == right));
+        DISPATCH();
+      }
+      CASE(NOT_EQUAL) :
+      {
+        NanValue right = POP();
+        NanValue left = POP();
+        PUSH(NanValue::boolean(!(left == right)));
+        DISPATCH();
+      }
+      CASE(GREATER) :
+      {
+        NUMBER_OPERANDS();
+        PUSH(NanValue::boolean(left > right));
+        DISPATCH();
+      }
+      CASE(GREATER_EQUAL) :
+      {
+        NUMBER_OPERANDS();
+        PUSH(NanValue::boolean(left >= right));
+        DISPATCH();
+      }
+      CASE(LESS) :
+      {
+        NUMBER_OPERANDS();
+        PUSH(NanValue::boolean(left < right));
+        DISPATCH();
+      }
+      CASE(LESS_EQUAL) :
+      {
+        NUMBER_OPERANDS();
+        PUSH(NanValue::boolean(left <= right));
+        DISPATCH();
+      }
+      CASE(ADD) :
+      {
+        if (PEEK(0).is_number() && PEEK(1).is_number())
+        {
+          double right = POP().as_number();
+          double left = POP().as_number();
+          PUSH(NanValue::number(left + right));
+        }
+        else if (PEEK(0).is_string() && PEEK(1).is_string())
+        {
+          Symbol right = POP().as_string();
+          Symbol left = POP().as_string();
+          m_concat.assign(m_strings.view(left));
+          m_concat.append(m_strings.view(right));
+          PUSH(NanValue::string(m_strings.intern(m_concat)));
+        }
+        else
+        {
+          throw fail("Operands must be two numbers or two strings.");
+        }
+        DISPATCH();
+      }
+      CASE(SUBTRACT) :
+      {
+        NUMBER_OPERANDS();
+        PUSH(NanValue::number(left - right));
+        DISPATCH();
+      }
+      CASE(MULTIPLY) :
+      {
+        NUMBER_OPERANDS();
+        PUSH(NanValue::number(left * right));
+        DISPATCH();
+      }
+      CASE(DIVIDE) :
+      {
+        NUMBER_OPERANDS();
+        PUSH(NanValue::number(left / right));
+        DISPATCH();
+      }
+      CASE(NOT) :
+      {
+        PEEK(0) = NanValue::boolean(!PEEK(0).is_truthy());
+        DISPATCH();
+      }
+      CASE(NEGATE) :
+      {
+        if (!PEEK(0).is_number()) throw fail("Operand must be a number.");
+        PEEK(0) = NanValue::number(-PEEK(0).as_number());
+        DISPATCH();
+      }
+      CASE(RETURN) :
+      {
+        return POP();
+      }
+    }
+#if !LOX_COMPUTED_GOTO
+  }
+#endif
+
+#undef PUSH
+#undef POP
+#undef PEEK
+#undef NUMBER_OPERANDS
+#undef DISPATCH
+#undef CASE
+}
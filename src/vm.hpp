@@ -0,0 +1,43 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "common.hpp"
+#include "nan_value.hpp"
+#include "source_map.hpp"
+#include "value.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct VmError : LoxException
+{
+  VmError(std::uint32_t source, const std::string &what) : LoxException(what), source(source)
+  {
+  }
+
+  std::uint32_t source; // offset of the token that failed
+};
+
+/*
+ * Stack machine running compiled chunks. Reports the same runtime errors as
+ * the Interpreter, so both can be compared on the same scripts.
+ */
+class VM
+{
+public:
+  explicit VM(StringTable &strings) : m_strings(strings)
+  {
+  }
+
+  // run chunk to its RETURN and give back the result, throws VmError on type errors
+  NanValue run(const Chunk &chunk);
+
+  // run chunk and print its value, runtime errors are reported at their
+  // position in source_map
+  void interpret(const Chunk &chunk, const SourceMap &source_map);
+
+private:
+  StringTable &m_strings;
+  std::vector<NanValue> m_stack;
+  std::string m_concat; // scratch buffer for string concatenation
+};